@@ -0,0 +1,300 @@
+#pragma once
+
+#include <algorithm>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ACTIVATION_X86 1
+#include <immintrin.h>
+#endif
+
+namespace activation
+{
+
+    /*!
+     * Accuracy / speed tradeoff of the activation functions
+     * exact : calls the C math library for every element (not vectorized)
+     * high  : polynomial approximation, relative error of exp around 1e-7 (a few ulp)
+     * fast  : lower degree polynomial and approximate reciprocal, relative error around 1e-3
+     */
+    enum class Accuracy
+    {
+        exact,
+        high,
+        fast
+    };
+
+    /*
+     * range reduction constants for exp: x = n * ln(2) + r, with ln(2) split in two parts for extra precision
+     */
+    const float LOG2E = 1.44269504088896341f;
+    const float LN2_HI = 0.693359375f;
+    const float LN2_LO = -2.12194440e-4f;
+    const float EXP_MIN = -87.0f;
+    const float EXP_MAX = 88.0f;
+
+    /*!
+     * Approximation of exp(x), using range reduction and a polynomial for exp(r) with |r| <= ln(2) / 2
+     */
+    template<Accuracy A>
+    float exp_approx(float x)
+    {
+        if(A == Accuracy::exact)
+        {
+            return exp(x);
+        }
+        x = std::min(std::max(x, EXP_MIN), EXP_MAX);
+        auto n = floorf(x * LOG2E + 0.5f);
+        auto r = x - n * LN2_HI - n * LN2_LO;
+        float y;
+        if(A == Accuracy::fast)
+        {
+            y = 1.0f + r * (1.0f + r * (0.5f + r * (1.0f / 6.0f)));
+        }
+        else
+        {
+            y = ((((1.9875691500e-4f * r + 1.3981999507e-3f) * r + 8.3334519073e-3f) * r + 4.1665795894e-2f) * r + 1.6666665459e-1f) * r + 5.0000001201e-1f;
+            y = y * r * r + r + 1.0f;
+        }
+        // multiply by 2^n by building the exponent bits directly
+        int32_t bits = ((int32_t) n + 127) << 23;
+        float scale;
+        memcpy(&scale, &bits, sizeof(scale));
+        return y * scale;
+    }
+
+#ifdef ACTIVATION_X86
+
+    bool use_avx2()
+    {
+        static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        return supported;
+    }
+
+    /*!
+     * 8-wide version of exp_approx
+     */
+    template<Accuracy A>
+    __attribute__((target("avx2,fma")))
+    __m256 exp_avx2(__m256 x)
+    {
+        x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(EXP_MIN)), _mm256_set1_ps(EXP_MAX));
+        auto n = _mm256_floor_ps(_mm256_fmadd_ps(x, _mm256_set1_ps(LOG2E), _mm256_set1_ps(0.5f)));
+        auto r = _mm256_fnmadd_ps(n, _mm256_set1_ps(LN2_HI), x);
+        r = _mm256_fnmadd_ps(n, _mm256_set1_ps(LN2_LO), r);
+        __m256 y;
+        if(A == Accuracy::fast)
+        {
+            y = _mm256_fmadd_ps(r, _mm256_set1_ps(1.0f / 6.0f), _mm256_set1_ps(0.5f));
+            y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(1.0f));
+            y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(1.0f));
+        }
+        else
+        {
+            y = _mm256_fmadd_ps(r, _mm256_set1_ps(1.9875691500e-4f), _mm256_set1_ps(1.3981999507e-3f));
+            y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(8.3334519073e-3f));
+            y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(4.1665795894e-2f));
+            y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(1.6666665459e-1f));
+            y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(5.0000001201e-1f));
+            y = _mm256_fmadd_ps(y, _mm256_mul_ps(r, r), _mm256_add_ps(r, _mm256_set1_ps(1.0f)));
+        }
+        auto bits = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+        return _mm256_mul_ps(y, _mm256_castsi256_ps(bits));
+    }
+
+    /*!
+     * 8-wide 1 / x (approximate reciprocal for Accuracy::fast)
+     */
+    template<Accuracy A>
+    __attribute__((target("avx2,fma")))
+    __m256 reciprocal_avx2(__m256 x)
+    {
+        if(A == Accuracy::fast)
+        {
+            return _mm256_rcp_ps(x);
+        }
+        return _mm256_div_ps(_mm256_set1_ps(1.0f), x);
+    }
+
+    template<Accuracy A>
+    __attribute__((target("avx2,fma")))
+    __m256 sigmoid_avx2(__m256 x)
+    {
+        auto e = exp_avx2<A>(_mm256_sub_ps(_mm256_setzero_ps(), x));
+        return reciprocal_avx2<A>(_mm256_add_ps(_mm256_set1_ps(1.0f), e));
+    }
+
+    template<Accuracy A>
+    __attribute__((target("avx2,fma")))
+    __m256 tanh_avx2(__m256 x)
+    {
+        // tanh(x) = 2 * sigmoid(2x) - 1
+        auto s = sigmoid_avx2<A>(_mm256_add_ps(x, x));
+        return _mm256_fmsub_ps(s, _mm256_set1_ps(2.0f), _mm256_set1_ps(1.0f));
+    }
+
+    /*
+     * 8-wide kernels, wrapped in types so they can be passed to apply_avx2
+     */
+    template<Accuracy A>
+    struct ExpAvx2
+    {
+        __attribute__((target("avx2,fma")))
+        static __m256 apply(__m256 x)
+        {
+            return exp_avx2<A>(x);
+        }
+    };
+
+    template<Accuracy A>
+    struct SigmoidAvx2
+    {
+        __attribute__((target("avx2,fma")))
+        static __m256 apply(__m256 x)
+        {
+            return sigmoid_avx2<A>(x);
+        }
+    };
+
+    template<Accuracy A>
+    struct TanhAvx2
+    {
+        __attribute__((target("avx2,fma")))
+        static __m256 apply(__m256 x)
+        {
+            return tanh_avx2<A>(x);
+        }
+    };
+
+    /*
+     * apply an 8-wide kernel to a buffer, the remaining elements go through the scalar version
+     */
+    template<typename VF, typename SF>
+    __attribute__((target("avx2,fma")))
+    void apply_avx2(const float* in, float* out, int n, const SF& sf)
+    {
+        int i = 0;
+        for(; i + 8 <= n; i += 8)
+        {
+            _mm256_storeu_ps(out + i, VF::apply(_mm256_loadu_ps(in + i)));
+        }
+        for(; i<n; i++)
+        {
+            out[i] = sf(in[i]);
+        }
+    }
+
+#endif
+
+    /*!
+     * The exponential function
+     */
+    template<Accuracy A = Accuracy::high>
+    struct Exp
+    {
+        float operator()(float x) const
+        {
+            return exp_approx<A>(x);
+        }
+
+        /*! double precision elements are always computed with the C math library
+         */
+        double operator()(double x) const
+        {
+            return exp(x);
+        }
+
+        /*! out[i] = exp(in[i]) for i in [0 .. n)
+         */
+        void apply(const float* in, float* out, int n) const
+        {
+#ifdef ACTIVATION_X86
+            if(A != Accuracy::exact && use_avx2())
+            {
+                apply_avx2<ExpAvx2<A>>(in, out, n, *this);
+                return;
+            }
+#endif
+            for(int i=0; i<n; i++)
+            {
+                out[i] = (*this)(in[i]);
+            }
+        }
+    };
+
+    /*!
+     * The logistic (sigmoid) function 1 / (1 + exp(-x))
+     */
+    template<Accuracy A = Accuracy::high>
+    struct Sigmoid
+    {
+        float operator()(float x) const
+        {
+            return 1.0f / (1.0f + exp_approx<A>(-x));
+        }
+
+        double operator()(double x) const
+        {
+            return 1.0 / (1.0 + exp(-x));
+        }
+
+        /*! out[i] = sigmoid(in[i]) for i in [0 .. n)
+         */
+        void apply(const float* in, float* out, int n) const
+        {
+#ifdef ACTIVATION_X86
+            if(A != Accuracy::exact && use_avx2())
+            {
+                apply_avx2<SigmoidAvx2<A>>(in, out, n, *this);
+                return;
+            }
+#endif
+            for(int i=0; i<n; i++)
+            {
+                out[i] = (*this)(in[i]);
+            }
+        }
+    };
+
+    /*!
+     * The hyperbolic tangent
+     * approximations are computed as 2 * sigmoid(2x) - 1, so their error is absolute rather than relative near 0
+     */
+    template<Accuracy A = Accuracy::high>
+    struct Tanh
+    {
+        float operator()(float x) const
+        {
+            if(A == Accuracy::exact)
+            {
+                return tanh(x);
+            }
+            return 2.0f / (1.0f + exp_approx<A>(-2.0f * x)) - 1.0f;
+        }
+
+        double operator()(double x) const
+        {
+            return tanh(x);
+        }
+
+        /*! out[i] = tanh(in[i]) for i in [0 .. n)
+         */
+        void apply(const float* in, float* out, int n) const
+        {
+#ifdef ACTIVATION_X86
+            if(A != Accuracy::exact && use_avx2())
+            {
+                apply_avx2<TanhAvx2<A>>(in, out, n, *this);
+                return;
+            }
+#endif
+            for(int i=0; i<n; i++)
+            {
+                out[i] = (*this)(in[i]);
+            }
+        }
+    };
+
+}
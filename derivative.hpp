@@ -1,10 +1,16 @@
 #pragma once
 
 #include <assert.h>
+#include <atomic>
 #include <functional>
 #include <math.h>
+#include <memory>
+#include <optional>
 #include <vector>
 
+#include "rng.hpp"
+#include "thread_pool.hpp"
+
 namespace numeric
 {
 
@@ -12,8 +18,10 @@ namespace numeric
      * In mathematics, a partial derivative of a function of several variables is its derivative with respect to one of those variables,
      * with the others held constant (as opposed to the total derivative, in which all variables are allowed to vary).
      * Partial derivatives are used in vector calculus and differential geometry.
+     * f can be any callable taking a (const reference to a) std::vector<float>, so that it can be inlined.
      */
-    std::function<float(std::vector<float>,int)> partial_derivative(const std::function<float(std::vector<float>)>& f, float eps = pow(10.0f, -4.0f))
+    template<typename F>
+    auto partial_derivative(const F& f, float eps = pow(10.0f, -4.0f))
     {
 
         /*
@@ -21,22 +29,192 @@ namespace numeric
          * its inputs are the coordinates at which to consider the partial derivative,
          * and the index of the variable to be allowed to vary.
          */
-        return [&f, eps](const std::vector<float>& xs, int var_index)
+        return [f, eps](const std::vector<float>& xs, int var_index)
         {
 
             assert(var_index >= 0);
             assert(var_index < xs.size());
 
-            std::vector<float> xs_mod_0 = xs;
-            xs_mod_0[var_index] += eps;
+            std::vector<float> xs_mod = xs;
+            xs_mod[var_index] += eps;
+            auto y_0 = f(xs_mod);
+
+            xs_mod[var_index] = xs[var_index] - eps;
+            auto y_1 = f(xs_mod);
+
+            return (y_0 - y_1) / (2 * eps);
+        };
+    }
+
+    /*!
+     * Partial derivative (see above) of a std::function.
+     */
+    std::function<float(std::vector<float>,int)> partial_derivative(const std::function<float(std::vector<float>)>& f, float eps = pow(10.0f, -4.0f))
+    {
+        return partial_derivative<std::function<float(std::vector<float>)>>(f, eps);
+    }
+
+    /*!
+     * A function that computes the gradient of a function of several variables at xs (first argument),
+     * writing the partial derivatives to ds (third argument).
+     * The value of the function at xs (second argument) is passed along by the caller, who usually knows it already.
+     */
+    typedef std::function<void(const std::vector<float>&, float, std::vector<float>&)> GradientFunction;
+
+    /*!
+     * Tag to select gradients approximated with finite differences (the default where automatic differentiation is optional).
+     */
+    struct FiniteDifferences
+    {
+    };
+
+    /*!
+     * Finite difference schemes for a partial derivative:
+     * central                   : (f(xs + eps) - f(xs - eps)) / (2 * eps), 2 evaluations of f per variable, error of order eps^2
+     * forward                   : (f(xs + eps) - f(xs)) / eps, 1 evaluation of f per variable (f(xs) is known), error of order eps
+     * simultaneous_perturbation : a random estimate of the whole gradient from 2 evaluations of f, whatever the number of variables
+     *                             (see spsa_gradient, eps is the initial perturbation size)
+     */
+    enum class Differences
+    {
+        central,
+        forward,
+        simultaneous_perturbation
+    };
+
+    /*!
+     * Simultaneous perturbation stochastic approximation (SPSA) of the gradient: all variables are perturbed at once,
+     * by +- c_k in a random direction (every component +1 or -1), and ds[i] = (f(xs + c_k d) - f(xs - c_k d)) / (2 c_k d[i]).
+     * The estimate is unbiased up to order c_k^2 and costs 2 evaluations of f per perturbation regardless of the number of variables,
+     * at the price of noise: use it with a decaying learning rate (e.g. spsa_learning_rate) for high-dimensional or black-box losses.
+     * The perturbation size decays with the number of calls k: c_k = perturbation / (k + 1)^gamma, counted over all copies
+     * of the returned callable. Directions are drawn from rng::thread_generator() of the calling thread, so they follow the seed
+     * when the gradient is used from one thread. Under concurrent use (e.g. multi_start_gradient_descent, which shares one gradient
+     * between its starts) k counts the calls of all threads together and neither the decay of a descent nor its directions are reproducible.
+     */
+    template<typename F>
+    auto spsa_gradient(
+        const F& f,					//! function to differentiate
+        float perturbation = 0.01f,			//! initial perturbation size c
+        float gamma = 0.101f,				//! decay exponent of the perturbation size
+        int number_of_perturbations = 1		//! number of estimates to average (2 evaluations of f each)
+    )
+    {
+        assert(perturbation > 0);
+        assert(number_of_perturbations >= 1);
+        auto calls = std::make_shared<std::atomic<int>>(0);
+        return [f, perturbation, gamma, number_of_perturbations, calls](const std::vector<float>& xs, float y, std::vector<float>& ds)
+        {
+            auto c = perturbation / pow(1.0f + (*calls)++, gamma);
+            auto& generator = rng::thread_generator();
+
+            // buffers reused across calls (per thread, the gradient may be shared by concurrent descents)
+            thread_local std::vector<float> xs_mod;
+            thread_local std::vector<float> direction;
+            xs_mod.resize(xs.size());
+            direction.resize(xs.size());
+            ds.assign(xs.size(), 0.0f);
+            for(int k=0; k<number_of_perturbations; k++)
+            {
+                for(int i=0; i<xs.size(); i++)
+                {
+                    direction[i] = generator.uniform_int(2) ? 1.0f : -1.0f;
+                    xs_mod[i] = xs[i] + c * direction[i];
+                }
+                auto y_0 = f(xs_mod);
+                for(int i=0; i<xs.size(); i++)
+                {
+                    xs_mod[i] = xs[i] - c * direction[i];
+                }
+                auto y_1 = f(xs_mod);
 
-            std::vector<float> xs_mod_1 = xs;
-            xs_mod_1[var_index] -= eps;
+                // 1 / direction[i] == direction[i]
+                auto slope = (y_0 - y_1) / (2 * c * number_of_perturbations);
+                for(int i=0; i<xs.size(); i++)
+                {
+                    ds[i] += slope * direction[i];
+                }
+            }
+        };
+    }
 
-            return ( f(xs_mod_0) - f(xs_mod_1) ) / (2 * eps);
+    /*!
+     * Gradient of f approximated with finite differences of each partial derivative.
+     * Each variable is perturbed in place in a copy of xs (and restored afterwards), so no vectors are copied per variable;
+     * the copy is a per-thread buffer reused across calls. With parallel set, the variables are split over the threads of the pool,
+     * each chunk working on the copy of its thread: f must then be safe to call concurrently.
+     * With Differences::simultaneous_perturbation the gradient is estimated with spsa_gradient instead (eps being the initial perturbation size).
+     * f can be any callable taking a (const reference to a) std::vector<float>; the returned callable has the signature of a GradientFunction.
+     */
+    template<typename F>
+    auto finite_difference_gradient(
+        const F& f,						//! function to differentiate
+        float eps = pow(10.0f, -4.0f),				//! step size
+        Differences differences = Differences::central,	//! finite difference scheme
+        bool parallel = false					//! flag to determine whether to evaluate the variables concurrently
+    )
+    {
+        // the spsa estimator (with its own copy of f) only exists for Differences::simultaneous_perturbation
+        std::optional<decltype(spsa_gradient(f, eps))> spsa;
+        if(differences == Differences::simultaneous_perturbation)
+        {
+            spsa.emplace(spsa_gradient(f, eps));
+        }
+        return [f, eps, differences, parallel, spsa](const std::vector<float>& xs, float y, std::vector<float>& ds)
+        {
+            if(spsa)
+            {
+                (*spsa)(xs, y, ds);
+                return;
+            }
+            ds.resize(xs.size());
+            auto partial_derivatives = [&f, &xs, y, &ds, eps, differences](int begin, int end)
+            {
+                // perturbed copy of xs, reused across calls (per thread, like the chunks)
+                thread_local std::vector<float> xs_mod;
+                xs_mod.assign(xs.begin(), xs.end());
+                for(int i=begin; i<end; i++)
+                {
+                    auto x = xs_mod[i];
+                    xs_mod[i] = x + eps;
+                    auto y_0 = f(xs_mod);
+                    if(differences == Differences::central)
+                    {
+                        xs_mod[i] = x - eps;
+                        ds[i] = (y_0 - f(xs_mod)) / (2 * eps);
+                    }
+                    else
+                    {
+                        ds[i] = (y_0 - y) / eps;
+                    }
+                    xs_mod[i] = x;
+                }
+            };
+            if(parallel)
+            {
+                // an evaluation of f is assumed to be worth a task of its own
+                parallel::parallel_for(0, xs.size(), parallel::serial_threshold(), partial_derivatives);
+            }
+            else
+            {
+                partial_derivatives(0, xs.size());
+            }
         };
     }
 
+    /*!
+     * Finite difference gradient (see above) of a std::function.
+     */
+    GradientFunction finite_difference_gradient(
+        const std::function<float(std::vector<float>)>& f,	//! function to differentiate
+        float eps = pow(10.0f, -4.0f),				//! step size
+        Differences differences = Differences::central,	//! finite difference scheme
+        bool parallel = false					//! flag to determine whether to evaluate the variables concurrently
+    )
+    {
+        return finite_difference_gradient<std::function<float(std::vector<float>)>>(f, eps, differences, parallel);
+    }
+
     /*!
      * The derivative of a function of a real variable measures the sensitivity to change
      * of the function value (output value) with respect to a change in its argument (input value).
@@ -44,11 +222,20 @@ namespace numeric
      * For example, the derivative of the position of a moving object with respect to time is the object's velocity:
      * this measures how quickly the position of the object changes when time advances.
      */
-    std::function<float(float)> derivative(const std::function<float(float)>& f, float eps = pow(10.0f, -4.0f))
+    template<typename F>
+    auto derivative(const F& f, float eps = pow(10.0f, -4.0f))
     {
-        return [&f, eps](float x)
+        return [f, eps](float x)
         {
             return ( f(x + eps) - f(x - eps) ) / (2 * eps);
         };
     }
+
+    /*!
+     * Derivative (see above) of a std::function.
+     */
+    std::function<float(float)> derivative(const std::function<float(float)>& f, float eps = pow(10.0f, -4.0f))
+    {
+        return derivative<std::function<float(float)>>(f, eps);
+    }
 }
@@ -0,0 +1,355 @@
+#pragma once
+
+#include <algorithm>
+#include <math.h>
+#include <type_traits>
+#include <vector>
+
+namespace autodiff
+{
+
+    /*!
+     * A dual number for forward-mode automatic differentiation: a value together with its derivatives
+     * with respect to N independent directions (d[0 .. N)). Arithmetic on duals applies the chain rule to all N
+     * components at once, in loops of fixed length that the compiler vectorizes.
+     * Evaluating a function on duals seeded with unit directions yields N partial derivatives in a single pass,
+     * exact up to rounding (no step size as with finite differences).
+     */
+    template<typename T, int N>
+    struct Dual
+    {
+        T value;
+        T d[N];
+
+        Dual() = default;
+
+        /*! a constant: all derivatives are zero
+         */
+        Dual(T value)
+            : value(value)
+        {
+            std::fill(d, d + N, T(0));
+        }
+
+        Dual& operator+=(const Dual& b)
+        {
+            value += b.value;
+            for(int k=0; k<N; k++)
+            {
+                d[k] += b.d[k];
+            }
+            return *this;
+        }
+
+        Dual& operator-=(const Dual& b)
+        {
+            value -= b.value;
+            for(int k=0; k<N; k++)
+            {
+                d[k] -= b.d[k];
+            }
+            return *this;
+        }
+
+        Dual& operator*=(const Dual& b)
+        {
+            for(int k=0; k<N; k++)
+            {
+                d[k] = d[k] * b.value + value * b.d[k];
+            }
+            value *= b.value;
+            return *this;
+        }
+
+        Dual& operator/=(const Dual& b)
+        {
+            auto inv = T(1) / b.value;
+            value *= inv;
+            for(int k=0; k<N; k++)
+            {
+                d[k] = (d[k] - value * b.d[k]) * inv;
+            }
+            return *this;
+        }
+    };
+
+    template<typename S>
+    using enable_if_scalar = typename std::enable_if<std::is_arithmetic<S>::value>::type;
+
+    /*
+     * apply the chain rule for a unary function: value f(a), derivative f'(a)
+     */
+    template<typename T, int N>
+    Dual<T, N> chain(const Dual<T, N>& a, T value, T derivative)
+    {
+        Dual<T, N> out;
+        out.value = value;
+        for(int k=0; k<N; k++)
+        {
+            out.d[k] = derivative * a.d[k];
+        }
+        return out;
+    }
+
+    template<typename T, int N>
+    Dual<T, N> operator-(const Dual<T, N>& a)
+    {
+        return chain(a, -a.value, T(-1));
+    }
+
+    template<typename T, int N>
+    Dual<T, N> operator+(Dual<T, N> a, const Dual<T, N>& b)
+    {
+        return a += b;
+    }
+
+    template<typename T, int N>
+    Dual<T, N> operator-(Dual<T, N> a, const Dual<T, N>& b)
+    {
+        return a -= b;
+    }
+
+    template<typename T, int N>
+    Dual<T, N> operator*(Dual<T, N> a, const Dual<T, N>& b)
+    {
+        return a *= b;
+    }
+
+    template<typename T, int N>
+    Dual<T, N> operator/(Dual<T, N> a, const Dual<T, N>& b)
+    {
+        return a /= b;
+    }
+
+    /*
+     * mixed arithmetic with plain numbers (constants), which only scale or shift the derivatives
+     */
+    template<typename T, int N, typename S, typename = enable_if_scalar<S>>
+    Dual<T, N> operator+(Dual<T, N> a, S s)
+    {
+        a.value += s;
+        return a;
+    }
+
+    template<typename T, int N, typename S, typename = enable_if_scalar<S>>
+    Dual<T, N> operator+(S s, Dual<T, N> a)
+    {
+        a.value += s;
+        return a;
+    }
+
+    template<typename T, int N, typename S, typename = enable_if_scalar<S>>
+    Dual<T, N> operator-(Dual<T, N> a, S s)
+    {
+        a.value -= s;
+        return a;
+    }
+
+    template<typename T, int N, typename S, typename = enable_if_scalar<S>>
+    Dual<T, N> operator-(S s, const Dual<T, N>& a)
+    {
+        return chain(a, T(s - a.value), T(-1));
+    }
+
+    template<typename T, int N, typename S, typename = enable_if_scalar<S>>
+    Dual<T, N> operator*(const Dual<T, N>& a, S s)
+    {
+        return chain(a, T(a.value * s), T(s));
+    }
+
+    template<typename T, int N, typename S, typename = enable_if_scalar<S>>
+    Dual<T, N> operator*(S s, const Dual<T, N>& a)
+    {
+        return chain(a, T(s * a.value), T(s));
+    }
+
+    template<typename T, int N, typename S, typename = enable_if_scalar<S>>
+    Dual<T, N> operator/(const Dual<T, N>& a, S s)
+    {
+        auto inv = T(1) / T(s);
+        return chain(a, a.value * inv, inv);
+    }
+
+    template<typename T, int N, typename S, typename = enable_if_scalar<S>>
+    Dual<T, N> operator/(S s, const Dual<T, N>& a)
+    {
+        auto value = T(s) / a.value;
+        return chain(a, value, -value / a.value);
+    }
+
+    /*
+     * comparisons look at values only, so branches (clamping, piecewise functions) pick the derivative of the branch taken
+     */
+    template<typename T, int N>
+    T value_of(const Dual<T, N>& a)
+    {
+        return a.value;
+    }
+
+    template<typename S, typename = enable_if_scalar<S>>
+    S value_of(S s)
+    {
+        return s;
+    }
+
+    template<typename A, typename B>
+    using enable_if_dual_comparison = typename std::enable_if < (!std::is_arithmetic<A>::value || !std::is_arithmetic<B>::value)
+                                      && std::is_arithmetic<decltype(value_of(std::declval<A>()))>::value
+                                      && std::is_arithmetic<decltype(value_of(std::declval<B>()))>::value >::type;
+
+    template<typename A, typename B, typename = enable_if_dual_comparison<A, B>>
+    bool operator<(const A& a, const B& b)
+    {
+        return value_of(a) < value_of(b);
+    }
+
+    template<typename A, typename B, typename = enable_if_dual_comparison<A, B>>
+    bool operator>(const A& a, const B& b)
+    {
+        return value_of(a) > value_of(b);
+    }
+
+    template<typename A, typename B, typename = enable_if_dual_comparison<A, B>>
+    bool operator<=(const A& a, const B& b)
+    {
+        return value_of(a) <= value_of(b);
+    }
+
+    template<typename A, typename B, typename = enable_if_dual_comparison<A, B>>
+    bool operator>=(const A& a, const B& b)
+    {
+        return value_of(a) >= value_of(b);
+    }
+
+    template<typename A, typename B, typename = enable_if_dual_comparison<A, B>>
+    bool operator==(const A& a, const B& b)
+    {
+        return value_of(a) == value_of(b);
+    }
+
+    template<typename A, typename B, typename = enable_if_dual_comparison<A, B>>
+    bool operator!=(const A& a, const B& b)
+    {
+        return value_of(a) != value_of(b);
+    }
+
+    /*
+     * elementary functions, found through argument dependent lookup (so generic code can simply call exp(x))
+     */
+    template<typename T, int N>
+    Dual<T, N> exp(const Dual<T, N>& a)
+    {
+        T e = ::exp(a.value);
+        return chain(a, e, e);
+    }
+
+    template<typename T, int N>
+    Dual<T, N> log(const Dual<T, N>& a)
+    {
+        return chain(a, T(::log(a.value)), T(1) / a.value);
+    }
+
+    template<typename T, int N>
+    Dual<T, N> sqrt(const Dual<T, N>& a)
+    {
+        T s = ::sqrt(a.value);
+        return chain(a, s, T(0.5) / s);
+    }
+
+    template<typename T, int N, typename S, typename = enable_if_scalar<S>>
+    Dual<T, N> pow(const Dual<T, N>& a, S p)
+    {
+        return chain(a, T(::pow(a.value, p)), T(p * ::pow(a.value, p - 1)));
+    }
+
+    template<typename T, int N>
+    Dual<T, N> sin(const Dual<T, N>& a)
+    {
+        return chain(a, T(::sin(a.value)), T(::cos(a.value)));
+    }
+
+    template<typename T, int N>
+    Dual<T, N> cos(const Dual<T, N>& a)
+    {
+        return chain(a, T(::cos(a.value)), T(-::sin(a.value)));
+    }
+
+    template<typename T, int N>
+    Dual<T, N> tanh(const Dual<T, N>& a)
+    {
+        T t = ::tanh(a.value);
+        return chain(a, t, T(1) - t * t);
+    }
+
+    template<typename T, int N>
+    Dual<T, N> fabs(const Dual<T, N>& a)
+    {
+        return chain(a, T(::fabs(a.value)), T(a.value < 0 ? -1 : 1));
+    }
+
+    template<typename T, int N>
+    Dual<T, N> abs(const Dual<T, N>& a)
+    {
+        return fabs(a);
+    }
+
+    /*!
+     * Tag to select forward-mode automatic differentiation (e.g. numeric::linear_regression(autodiff::forward_mode, ...)).
+     */
+    struct ForwardMode
+    {
+    };
+
+    const ForwardMode forward_mode{};
+
+    /*!
+     * Evaluate f at xs and compute its gradient into ds, with forward-mode automatic differentiation.
+     * f must be callable with a std::vector of any scalar type S (float, or dual numbers) and return an S.
+     * Each pass seeds N parameters, so the gradient costs ceil(xs.size() / N) evaluations of f on duals.
+     * Returns f(xs).
+     */
+    template<int N = 8, typename F>
+    float gradient(const F& f, const std::vector<float>& xs, std::vector<float>& ds)
+    {
+        typedef Dual<float, N> D;
+        int n = xs.size();
+        ds.resize(n);
+        std::vector<D> duals(xs.begin(), xs.end());
+        auto value = 0.0f;
+        for(int begin=0; begin<std::max(n, 1); begin+=N)
+        {
+            auto end = std::min(begin + N, n);
+            for(int i=begin; i<end; i++)
+            {
+                duals[i].d[i - begin] = 1.0f;
+            }
+            D y = f(duals);
+            value = y.value;
+            for(int i=begin; i<end; i++)
+            {
+                ds[i] = y.d[i - begin];
+                duals[i].d[i - begin] = 0.0f;
+            }
+        }
+        return value;
+    }
+
+    template<typename F>
+    float gradient(ForwardMode, const F& f, const std::vector<float>& xs, std::vector<float>& ds)
+    {
+        return gradient(f, xs, ds);
+    }
+
+    /*!
+     * Derivative of a function of a single variable, evaluated with a dual number.
+     */
+    template<typename F>
+    float derivative(const F& f, float x)
+    {
+        Dual<float, 1> a(x);
+        a.d[0] = 1.0f;
+        Dual<float, 1> y = f(a);
+        return y.d[0];
+    }
+
+}
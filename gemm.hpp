@@ -0,0 +1,408 @@
+#pragma once
+
+#include <algorithm>
+#include <assert.h>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MATRIX_GEMM_X86 1
+#include <immintrin.h>
+#endif
+
+namespace matrix
+{
+    namespace gemm
+    {
+
+        /*!
+         * A micro-kernel computes c[0..mr)[0..nr) += a * b for one register tile,
+         * where a is a packed panel of mr rows (stored k-major) and b is a packed panel of nr columns (stored k-major).
+         */
+        typedef void (*MicroKernel)(int k, const float* a, const float* b, float* c, int ldc);
+
+        /*!
+         * Description of a micro-kernel and its register tile dimensions.
+         */
+        struct Kernel
+        {
+            const char* name;
+            int mr;
+            int nr;
+            MicroKernel micro_kernel;
+        };
+
+        /*
+         * cache blocking parameters
+         * kc * nr floats of b (one packed panel) should stay in L1,
+         * mc * kc floats of a (one packed block) should stay in L2,
+         * kc * nc floats of b (one packed block) should stay in L3.
+         */
+        const int KC = 256;
+        const int MC = 96;
+        const int NC = 2048;
+
+        /*
+         * below this number of multiply-adds, packing costs more than it saves
+         */
+        const long SMALL_PRODUCT_THRESHOLD = 32 * 32 * 32;
+
+        /*!
+         * Portable micro-kernel, written so that the compiler can keep the accumulators in registers.
+         */
+        template<int MR, int NR>
+        void micro_kernel_generic(int k, const float* a, const float* b, float* c, int ldc)
+        {
+            float acc[MR][NR] = {};
+            for(int p=0; p<k; p++)
+            {
+                for(int i=0; i<MR; i++)
+                {
+                    auto a_ip = a[p * MR + i];
+                    for(int j=0; j<NR; j++)
+                    {
+                        acc[i][j] += a_ip * b[p * NR + j];
+                    }
+                }
+            }
+            for(int i=0; i<MR; i++)
+            {
+                for(int j=0; j<NR; j++)
+                {
+                    c[i * ldc + j] += acc[i][j];
+                }
+            }
+        }
+
+#ifdef MATRIX_GEMM_X86
+
+        /*!
+         * AVX2/FMA micro-kernel, 6 rows by 16 columns (12 ymm accumulators).
+         */
+        __attribute__((target("avx2,fma")))
+        void micro_kernel_avx2(int k, const float* a, const float* b, float* c, int ldc)
+        {
+            __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+            __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+            __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+            __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+            __m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+            __m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+            for(int p=0; p<k; p++)
+            {
+                auto b0 = _mm256_loadu_ps(b);
+                auto b1 = _mm256_loadu_ps(b + 8);
+                __m256 ai;
+                ai = _mm256_broadcast_ss(a + 0);
+                c00 = _mm256_fmadd_ps(ai, b0, c00);
+                c01 = _mm256_fmadd_ps(ai, b1, c01);
+                ai = _mm256_broadcast_ss(a + 1);
+                c10 = _mm256_fmadd_ps(ai, b0, c10);
+                c11 = _mm256_fmadd_ps(ai, b1, c11);
+                ai = _mm256_broadcast_ss(a + 2);
+                c20 = _mm256_fmadd_ps(ai, b0, c20);
+                c21 = _mm256_fmadd_ps(ai, b1, c21);
+                ai = _mm256_broadcast_ss(a + 3);
+                c30 = _mm256_fmadd_ps(ai, b0, c30);
+                c31 = _mm256_fmadd_ps(ai, b1, c31);
+                ai = _mm256_broadcast_ss(a + 4);
+                c40 = _mm256_fmadd_ps(ai, b0, c40);
+                c41 = _mm256_fmadd_ps(ai, b1, c41);
+                ai = _mm256_broadcast_ss(a + 5);
+                c50 = _mm256_fmadd_ps(ai, b0, c50);
+                c51 = _mm256_fmadd_ps(ai, b1, c51);
+                a += 6;
+                b += 16;
+            }
+            __m256 acc[6][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51}};
+            for(int i=0; i<6; i++)
+            {
+                auto c_row = c + i * ldc;
+                _mm256_storeu_ps(c_row, _mm256_add_ps(_mm256_loadu_ps(c_row), acc[i][0]));
+                _mm256_storeu_ps(c_row + 8, _mm256_add_ps(_mm256_loadu_ps(c_row + 8), acc[i][1]));
+            }
+        }
+
+        /*!
+         * AVX-512 micro-kernel, 8 rows by 32 columns (16 zmm accumulators).
+         */
+        __attribute__((target("avx512f")))
+        void micro_kernel_avx512(int k, const float* a, const float* b, float* c, int ldc)
+        {
+            __m512 acc[8][2];
+            for(int i=0; i<8; i++)
+            {
+                acc[i][0] = _mm512_setzero_ps();
+                acc[i][1] = _mm512_setzero_ps();
+            }
+            for(int p=0; p<k; p++)
+            {
+                auto b0 = _mm512_loadu_ps(b);
+                auto b1 = _mm512_loadu_ps(b + 16);
+                for(int i=0; i<8; i++)
+                {
+                    auto ai = _mm512_set1_ps(a[i]);
+                    acc[i][0] = _mm512_fmadd_ps(ai, b0, acc[i][0]);
+                    acc[i][1] = _mm512_fmadd_ps(ai, b1, acc[i][1]);
+                }
+                a += 8;
+                b += 32;
+            }
+            for(int i=0; i<8; i++)
+            {
+                auto c_row = c + i * ldc;
+                _mm512_storeu_ps(c_row, _mm512_add_ps(_mm512_loadu_ps(c_row), acc[i][0]));
+                _mm512_storeu_ps(c_row + 16, _mm512_add_ps(_mm512_loadu_ps(c_row + 16), acc[i][1]));
+            }
+        }
+
+#endif
+
+        /*!
+         * Return all micro-kernels the CPU we are running on supports (checked through CPUID), widest first.
+         */
+        std::vector<Kernel> available_kernels()
+        {
+            std::vector<Kernel> out;
+#ifdef MATRIX_GEMM_X86
+            if(__builtin_cpu_supports("avx512f"))
+            {
+                out.push_back({"avx512", 8, 32, &micro_kernel_avx512});
+            }
+            if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+            {
+                out.push_back({"avx2", 6, 16, &micro_kernel_avx2});
+            }
+#endif
+            out.push_back({"generic", 4, 8, &micro_kernel_generic<4, 8>});
+            return out;
+        }
+
+        /*!
+         * Return the widest micro-kernel the CPU supports (selected once, on first use).
+         */
+        const Kernel& kernel()
+        {
+            static const Kernel selected = available_kernels()[0];
+            return selected;
+        }
+
+        /*!
+         * Pack an mc x kc block of a into panels of mr rows, each panel stored k-major.
+         * Element (i, p) of the block is a[i * rsa + p * csa], which covers both a and its transpose.
+         * Rows beyond mc are padded with zeroes, so the micro-kernel never needs to check bounds.
+         * Elements of other storage types (bfloat16, float16) are converted to float while packing.
+         */
+        template<typename T>
+        void pack_a(int mc, int kc, const T* a, int rsa, int csa, int mr, float* out)
+        {
+            for(int i0=0; i0<mc; i0+=mr)
+            {
+                auto m = std::min(mr, mc - i0);
+                for(int p=0; p<kc; p++)
+                {
+                    for(int i=0; i<m; i++)
+                    {
+                        out[i] = a[(i0 + i) * rsa + p * csa];
+                    }
+                    for(int i=m; i<mr; i++)
+                    {
+                        out[i] = 0.0f;
+                    }
+                    out += mr;
+                }
+            }
+        }
+
+        /*!
+         * Pack a kc x nc block of b into panels of nr columns, each panel stored k-major.
+         * Element (p, j) of the block is b[p * rsb + j * csb], which covers both b and its transpose.
+         * Columns beyond nc are padded with zeroes.
+         */
+        template<typename T>
+        void pack_b(int kc, int nc, const T* b, int rsb, int csb, int nr, float* out)
+        {
+            for(int j0=0; j0<nc; j0+=nr)
+            {
+                auto n = std::min(nr, nc - j0);
+                for(int p=0; p<kc; p++)
+                {
+                    auto b_row = b + p * rsb + j0 * csb;
+                    for(int j=0; j<n; j++)
+                    {
+                        out[j] = b_row[j * csb];
+                    }
+                    for(int j=n; j<nr; j++)
+                    {
+                        out[j] = 0.0f;
+                    }
+                    out += nr;
+                }
+            }
+        }
+
+        /*!
+         * Straightforward product for small operands, where packing would dominate.
+         * When only b is transposed every element of c is a dot product of two contiguous rows,
+         * otherwise the loops run in i-k-j order so that the innermost loop walks c contiguously.
+         * Products are accumulated in the element type of c.
+         */
+        template<typename T, typename C>
+        void gemm_small(bool transpose_a, bool transpose_b, int M, int N, int K, const T* a, int lda, const T* b, int ldb, C* c, int ldc)
+        {
+            if(!transpose_a && transpose_b)
+            {
+                for(int i=0; i<M; i++)
+                {
+                    auto a_row = a + i * lda;
+                    for(int j=0; j<N; j++)
+                    {
+                        auto b_row = b + j * ldb;
+                        C sum = 0;
+                        for(int p=0; p<K; p++)
+                        {
+                            sum += (C) a_row[p] * (C) b_row[p];
+                        }
+                        c[i * ldc + j] += sum;
+                    }
+                }
+                return;
+            }
+            auto rsa = transpose_a ? 1 : lda;
+            auto csa = transpose_a ? lda : 1;
+            auto rsb = transpose_b ? 1 : ldb;
+            auto csb = transpose_b ? ldb : 1;
+            for(int i=0; i<M; i++)
+            {
+                auto c_row = c + i * ldc;
+                for(int p=0; p<K; p++)
+                {
+                    C a_ip = a[i * rsa + p * csa];
+                    auto b_row = b + p * rsb;
+                    for(int j=0; j<N; j++)
+                    {
+                        c_row[j] += a_ip * (C) b_row[j * csb];
+                    }
+                }
+            }
+        }
+
+        /*!
+         * Single precision general matrix multiply, c += op(a) * op(b)
+         * where op(x) is either x or its transpose (the NN, NT, TN and TT forms), so transposes never need to be materialized.
+         * op(a) is M x K, op(b) is K x N and c is M x N. All matrices are stored row-major with leading dimensions lda, ldb and ldc
+         * (a is stored as K x M when it is transposed, b as N x K).
+         * Operands are packed into cache-sized blocks and multiplied with a register-tiled micro-kernel.
+         * a and b may also hold bfloat16 or float16 elements: they are widened to float while packing, so accumulation is always in float.
+         */
+        template<typename T>
+        void sgemm(const Kernel& kern, bool transpose_a, bool transpose_b, int M, int N, int K, const T* a, int lda, const T* b, int ldb, float* c, int ldc)
+        {
+            assert(M >= 0 && N >= 0 && K >= 0);
+            if(M == 0 || N == 0 || K == 0)
+            {
+                return;
+            }
+
+            // strides of op(a) and op(b)
+            auto rsa = transpose_a ? 1 : lda;
+            auto csa = transpose_a ? lda : 1;
+            auto rsb = transpose_b ? 1 : ldb;
+            auto csb = transpose_b ? ldb : 1;
+
+            auto mr = kern.mr;
+            auto nr = kern.nr;
+
+            // packing buffers are reused between calls
+            thread_local std::vector<float> a_packed;
+            thread_local std::vector<float> b_packed;
+            a_packed.resize((MC + mr) * KC);
+            b_packed.resize((NC + nr) * KC);
+
+            // scratch tile for the edges of c
+            float tile[32 * 32];
+            assert(mr * nr <= 32 * 32);
+
+            for(int jc=0; jc<N; jc+=NC)
+            {
+                auto nc = std::min(NC, N - jc);
+                for(int pc=0; pc<K; pc+=KC)
+                {
+                    auto kc = std::min(KC, K - pc);
+                    pack_b(kc, nc, b + pc * rsb + jc * csb, rsb, csb, nr, b_packed.data());
+                    for(int ic=0; ic<M; ic+=MC)
+                    {
+                        auto mc = std::min(MC, M - ic);
+                        pack_a(mc, kc, a + ic * rsa + pc * csa, rsa, csa, mr, a_packed.data());
+                        for(int jr=0; jr<nc; jr+=nr)
+                        {
+                            auto n = std::min(nr, nc - jr);
+                            auto b_panel = b_packed.data() + jr * kc;
+                            for(int ir=0; ir<mc; ir+=mr)
+                            {
+                                auto m = std::min(mr, mc - ir);
+                                auto a_panel = a_packed.data() + ir * kc;
+                                auto c_tile = c + (ic + ir) * ldc + jc + jr;
+                                if(m == mr && n == nr)
+                                {
+                                    kern.micro_kernel(kc, a_panel, b_panel, c_tile, ldc);
+                                }
+                                else
+                                {
+                                    std::fill(tile, tile + mr * nr, 0.0f);
+                                    kern.micro_kernel(kc, a_panel, b_panel, tile, nr);
+                                    for(int i=0; i<m; i++)
+                                    {
+                                        for(int j=0; j<n; j++)
+                                        {
+                                            c_tile[i * ldc + j] += tile[i * nr + j];
+                                        }
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        /*!
+         * Single precision general matrix multiply, c += op(a) * op(b) (see above), using the best kernel for this CPU.
+         * Small products skip packing altogether.
+         */
+        template<typename T>
+        void sgemm(bool transpose_a, bool transpose_b, int M, int N, int K, const T* a, int lda, const T* b, int ldb, float* c, int ldc)
+        {
+            if((long) M * N * K <= SMALL_PRODUCT_THRESHOLD)
+            {
+                gemm_small(transpose_a, transpose_b, M, N, K, a, lda, b, ldb, c, ldc);
+                return;
+            }
+            sgemm(kernel(), transpose_a, transpose_b, M, N, K, a, lda, b, ldb, c, ldc);
+        }
+
+        /*!
+         * Double precision general matrix multiply, c += op(a) * op(b), accumulated in double.
+         * There is no packed kernel for double, it always takes the straightforward path.
+         */
+        void dgemm(bool transpose_a, bool transpose_b, int M, int N, int K, const double* a, int lda, const double* b, int ldb, double* c, int ldc)
+        {
+            gemm_small(transpose_a, transpose_b, M, N, K, a, lda, b, ldb, c, ldc);
+        }
+
+        /*!
+         * General matrix multiply for any storage type: c += op(a) * op(b), accumulated in the element type of c
+         * (float for float, bfloat16 and float16 operands, double for double operands).
+         */
+        template<typename T>
+        void gemm(bool transpose_a, bool transpose_b, int M, int N, int K, const T* a, int lda, const T* b, int ldb, float* c, int ldc)
+        {
+            sgemm(transpose_a, transpose_b, M, N, K, a, lda, b, ldb, c, ldc);
+        }
+
+        void gemm(bool transpose_a, bool transpose_b, int M, int N, int K, const double* a, int lda, const double* b, int ldb, double* c, int ldc)
+        {
+            dgemm(transpose_a, transpose_b, M, N, K, a, lda, b, ldb, c, ldc);
+        }
+
+    }
+}
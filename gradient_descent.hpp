@@ -1,8 +1,14 @@
 #pragma once
 
 #include "derivative.hpp"
+#include "optimizer.hpp"
+#include "reductions.hpp"
+#include "rng.hpp"
+#include "schedule.hpp"
+#include "thread_pool.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <limits>
 #include <math.h>
@@ -45,17 +51,37 @@ namespace numeric
     }
 
     /*!
-     * Gradient descent is a first-order iterative optimization algorithm for finding a local minimum of a differentiable function.
-     * To find a local minimum of a function using gradient descent, we take steps proportional to the negative of the gradient
-     * (or approximate gradient) of the function at the current point.
+     * Learning rate schedules seek to adjust the learning rate during training by reducing the learning rate according to a pre-defined schedule.
+     * The SPSA gain sequence a / (iteration_nr + 1 + stability)^alpha decays slowly enough for gradient descent to converge
+     * with noisy gradient estimates (e.g. spsa_gradient); alpha = 0.602 is the customary choice, stability (about 10% of the
+     * number of iterations) keeps the first steps from being too large.
      */
-    std::vector<float> gradient_descent(
-        const std::function<float(std::vector<float>)>& f, 		//! function to perform gradient descent on
+    std::function<float(int)> spsa_learning_rate(float a, float stability = 0.0f, float alpha = 0.602f)
+    {
+        assert(a > 0);
+        assert(stability >= 0);
+        return [a, stability, alpha](int iteration_nr)
+        {
+            return a / pow(iteration_nr + 1.0f + stability, alpha);
+        };
+    }
+
+    /*
+     * the gradient descent loop: returns the best xs found, and their value in best_y.
+     * give_up(iteration_nr, y) is asked after every iteration whether to abandon the search.
+     */
+    template<typename F, typename G, typename C>
+    std::vector<float> gradient_descent_loop(
+        const F& f, 							//! function to perform gradient descent on
+        const G& gradient,						//! function that computes the gradient of f (e.g. with automatic differentiation)
         const std::vector<float>& initial_xs, 				//! initial guess for the (local) minimum
-        const std::function<float(int)>& learning_rate_schedule,	//! function that determines the learning rate based on the iteration nr
-        int max_number_of_iterations = 16348,				//! maximum number of iterations
-        bool stop_when_partial_derivative_is_zero = true,		//! flag to determine whether to stop when the partial derivative is zero
-        bool stop_when_learning_rate_is_too_small = true		//! flag to determine whether to stop when the learning rate becomes too small
+        optim::Schedule& learning_rate_schedule,			//! schedule that determines the learning rate, and observes the value of f
+        optim::Optimizer<>& optimizer,					//! update rule
+        int max_number_of_iterations,
+        bool stop_when_partial_derivative_is_zero,
+        bool stop_when_learning_rate_is_too_small,
+        const C& give_up,
+        float& best_y
     )
     {
 
@@ -69,30 +95,26 @@ namespace numeric
         std::vector<float> ds = initial_xs;
 
         // iterations of gradient descent
+        float y = f(xs);
         auto best_xs = xs;
-        auto best_y = f(xs);
+        best_y = y;
         for(int j=0; j<max_number_of_iterations; j++)
         {
 
             // calculate partial derivatives
-            for(int i=0; i<xs.size(); i++)
-            {
-                ds[i] = partial_derivative(f)(xs, i);
-            }
+            gradient(xs, y, ds);
 
             // update
-            for(int i=0; i<xs.size(); i++)
-            {
-                xs[i] -= learning_rate * ds[i];
-            }
+            optimizer.update(0, xs, ds, learning_rate);
 
             // update learning rate if needed
-            auto y = f(xs);
+            y = f(xs);
             if(y < best_y)
             {
                 best_y = y;
                 best_xs = xs;
             }
+            learning_rate_schedule.observe(y);
 
             // ensure learning rate is reasonably limited [0 .. 1]
             learning_rate = learning_rate_schedule(j);
@@ -105,12 +127,13 @@ namespace numeric
             }
 
             // escape optimization loop if all partial derivatives are zero
-            auto all_ds_zero = true;
-            for(int k=0; k<ds.size(); k++)
+            if(stop_when_partial_derivative_is_zero && matrix::norm_inf(matrix::as_row(ds)) == 0)
             {
-                all_ds_zero &= (ds[k] == 0);
+                break;
             }
-            if(stop_when_partial_derivative_is_zero && all_ds_zero)
+
+            // escape optimization loop if the search is abandoned
+            if(give_up(j, y))
             {
                 break;
             }
@@ -122,6 +145,248 @@ namespace numeric
 
     }
 
+    /*!
+     * Gradient descent is a first-order iterative optimization algorithm for finding a local minimum of a differentiable function.
+     * To find a local minimum of a function using gradient descent, we take steps proportional to the negative of the gradient
+     * (or approximate gradient) of the function at the current point.
+     * The steps are taken by an optimizer (e.g. optim::Adam), which may keep state between iterations.
+     * f and gradient can be any callables (with the signatures of std::function<float(std::vector<float>)> and GradientFunction),
+     * so that they can be inlined into the loop.
+     * The schedule observes the value of f after every iteration (e.g. optim::ReduceOnPlateau, see schedule.hpp).
+     */
+    template<typename F, typename G>
+    std::vector<float> gradient_descent(
+        const F& f, 							//! function to perform gradient descent on
+        const G& gradient,						//! function that computes the gradient of f (e.g. with automatic differentiation)
+        const std::vector<float>& initial_xs, 				//! initial guess for the (local) minimum
+        optim::Schedule& learning_rate_schedule,			//! schedule that determines the learning rate, and observes the value of f
+        optim::Optimizer<>& optimizer,					//! update rule
+        int max_number_of_iterations = 16348,				//! maximum number of iterations
+        bool stop_when_partial_derivative_is_zero = true,		//! flag to determine whether to stop when the partial derivative is zero
+        bool stop_when_learning_rate_is_too_small = true		//! flag to determine whether to stop when the learning rate becomes too small
+    )
+    {
+        auto never = [](int iteration_nr, float y)
+        {
+            return false;
+        };
+        float best_y;
+        return gradient_descent_loop(f, gradient, initial_xs, learning_rate_schedule, optimizer, max_number_of_iterations,
+                                     stop_when_partial_derivative_is_zero, stop_when_learning_rate_is_too_small, never, best_y);
+    }
+
+    /*!
+     * Gradient descent (see above) with a learning rate schedule that is a function of the iteration nr.
+     */
+    template<typename F, typename G>
+    std::vector<float> gradient_descent(
+        const F& f, 							//! function to perform gradient descent on
+        const G& gradient,						//! function that computes the gradient of f (e.g. with automatic differentiation)
+        const std::vector<float>& initial_xs, 				//! initial guess for the (local) minimum
+        const std::function<float(int)>& learning_rate_schedule,	//! function that determines the learning rate based on the iteration nr
+        optim::Optimizer<>& optimizer,					//! update rule
+        int max_number_of_iterations = 16348,				//! maximum number of iterations
+        bool stop_when_partial_derivative_is_zero = true,		//! flag to determine whether to stop when the partial derivative is zero
+        bool stop_when_learning_rate_is_too_small = true		//! flag to determine whether to stop when the learning rate becomes too small
+    )
+    {
+        optim::FunctionSchedule schedule(learning_rate_schedule);
+        return gradient_descent(f, gradient, initial_xs, schedule, optimizer, max_number_of_iterations,
+                                stop_when_partial_derivative_is_zero, stop_when_learning_rate_is_too_small);
+    }
+
+    /*!
+     * Gradient descent is a first-order iterative optimization algorithm for finding a local minimum of a differentiable function.
+     * To find a local minimum of a function using gradient descent, we take steps proportional to the negative of the gradient
+     * (or approximate gradient) of the function at the current point.
+     */
+    template<typename F, typename G>
+    std::vector<float> gradient_descent(
+        const F& f, 							//! function to perform gradient descent on
+        const G& gradient,						//! function that computes the gradient of f (e.g. with automatic differentiation)
+        const std::vector<float>& initial_xs, 				//! initial guess for the (local) minimum
+        const std::function<float(int)>& learning_rate_schedule,	//! function that determines the learning rate based on the iteration nr
+        int max_number_of_iterations = 16348,				//! maximum number of iterations
+        bool stop_when_partial_derivative_is_zero = true,		//! flag to determine whether to stop when the partial derivative is zero
+        bool stop_when_learning_rate_is_too_small = true		//! flag to determine whether to stop when the learning rate becomes too small
+    )
+    {
+        optim::SGD<> sgd;
+        return gradient_descent(f, gradient, initial_xs, learning_rate_schedule, sgd, max_number_of_iterations,
+                                stop_when_partial_derivative_is_zero, stop_when_learning_rate_is_too_small);
+    }
+
+    /*!
+     * Gradient descent (see above) with an optimizer, on std::functions.
+     */
+    std::vector<float> gradient_descent(
+        const std::function<float(std::vector<float>)>& f, 		//! function to perform gradient descent on
+        const GradientFunction& gradient,				//! function that computes the gradient of f (e.g. with automatic differentiation)
+        const std::vector<float>& initial_xs, 				//! initial guess for the (local) minimum
+        const std::function<float(int)>& learning_rate_schedule,	//! function that determines the learning rate based on the iteration nr
+        optim::Optimizer<>& optimizer,					//! update rule
+        int max_number_of_iterations = 16348,				//! maximum number of iterations
+        bool stop_when_partial_derivative_is_zero = true,		//! flag to determine whether to stop when the partial derivative is zero
+        bool stop_when_learning_rate_is_too_small = true		//! flag to determine whether to stop when the learning rate becomes too small
+    )
+    {
+        return gradient_descent<std::function<float(std::vector<float>)>, GradientFunction>(f, gradient, initial_xs, learning_rate_schedule, optimizer,
+                max_number_of_iterations, stop_when_partial_derivative_is_zero, stop_when_learning_rate_is_too_small);
+    }
+
+    /*!
+     * Gradient descent (see above) on std::functions.
+     */
+    std::vector<float> gradient_descent(
+        const std::function<float(std::vector<float>)>& f, 		//! function to perform gradient descent on
+        const GradientFunction& gradient,				//! function that computes the gradient of f (e.g. with automatic differentiation)
+        const std::vector<float>& initial_xs, 				//! initial guess for the (local) minimum
+        const std::function<float(int)>& learning_rate_schedule,	//! function that determines the learning rate based on the iteration nr
+        int max_number_of_iterations = 16348,				//! maximum number of iterations
+        bool stop_when_partial_derivative_is_zero = true,		//! flag to determine whether to stop when the partial derivative is zero
+        bool stop_when_learning_rate_is_too_small = true		//! flag to determine whether to stop when the learning rate becomes too small
+    )
+    {
+        return gradient_descent<std::function<float(std::vector<float>)>, GradientFunction>(f, gradient, initial_xs, learning_rate_schedule,
+                max_number_of_iterations, stop_when_partial_derivative_is_zero, stop_when_learning_rate_is_too_small);
+    }
+
+    /*!
+     * Gradient descent is a first-order iterative optimization algorithm for finding a local minimum of a differentiable function.
+     * To find a local minimum of a function using gradient descent, we take steps proportional to the negative of the gradient
+     * (or approximate gradient) of the function at the current point.
+     * The gradient is approximated with finite differences, optionally evaluated concurrently on the thread pool,
+     * or estimated with simultaneous perturbations (see spsa_gradient, best combined with spsa_learning_rate).
+     */
+    template<typename F>
+    std::vector<float> gradient_descent(
+        const F& f, 							//! function to perform gradient descent on
+        const std::vector<float>& initial_xs, 				//! initial guess for the (local) minimum
+        const std::function<float(int)>& learning_rate_schedule,	//! function that determines the learning rate based on the iteration nr
+        int max_number_of_iterations = 16348,				//! maximum number of iterations
+        bool stop_when_partial_derivative_is_zero = true,		//! flag to determine whether to stop when the partial derivative is zero
+        bool stop_when_learning_rate_is_too_small = true,		//! flag to determine whether to stop when the learning rate becomes too small
+        Differences differences = Differences::central,		//! finite difference scheme (forward differences reuse f(xs), simultaneous perturbation costs 2 evaluations)
+        bool parallel = false						//! flag to determine whether to evaluate the partial derivatives concurrently (f must be thread safe)
+    )
+    {
+        // random perturbations need to be large enough to stand out from the rounding errors of f
+        auto eps = differences == Differences::simultaneous_perturbation ? 0.01f : pow(10.0f, -4.0f);
+        return gradient_descent(f, finite_difference_gradient(f, eps, differences, parallel), initial_xs, learning_rate_schedule, max_number_of_iterations,
+                                stop_when_partial_derivative_is_zero, stop_when_learning_rate_is_too_small);
+    }
+
+    /*!
+     * Gradient descent (see above) on a std::function, with the gradient approximated with finite differences.
+     */
+    std::vector<float> gradient_descent(
+        const std::function<float(std::vector<float>)>& f, 		//! function to perform gradient descent on
+        const std::vector<float>& initial_xs, 				//! initial guess for the (local) minimum
+        const std::function<float(int)>& learning_rate_schedule,	//! function that determines the learning rate based on the iteration nr
+        int max_number_of_iterations = 16348,				//! maximum number of iterations
+        bool stop_when_partial_derivative_is_zero = true,		//! flag to determine whether to stop when the partial derivative is zero
+        bool stop_when_learning_rate_is_too_small = true,		//! flag to determine whether to stop when the learning rate becomes too small
+        Differences differences = Differences::central,		//! finite difference scheme (forward differences reuse f(xs), simultaneous perturbation costs 2 evaluations)
+        bool parallel = false						//! flag to determine whether to evaluate the partial derivatives concurrently (f must be thread safe)
+    )
+    {
+        return gradient_descent<std::function<float(std::vector<float>)>>(f, initial_xs, learning_rate_schedule, max_number_of_iterations,
+                stop_when_partial_derivative_is_zero, stop_when_learning_rate_is_too_small, differences, parallel);
+    }
+
+    /*!
+     * Multi-start gradient descent: gradient descent from number_of_starts starting points, run concurrently on the thread pool,
+     * returning the best minimum found. The first start is initial_xs itself, the others are drawn uniformly from
+     * initial_xs +- radius (with rng::thread_generator() of the calling thread, so the starts follow the seed).
+     * The runs share the best value found so far: every check_interval iterations, a run whose value is worse than it
+     * by more than cancel_margin * max(1, |best|) is cancelled (pass infinity to never cancel).
+     * Which runs are cancelled depends on their timing, so f and gradient must be safe to call concurrently.
+     */
+    template<typename F, typename G>
+    std::vector<float> multi_start_gradient_descent(
+        const F& f, 							//! function to perform gradient descent on
+        const G& gradient,						//! function that computes the gradient of f (e.g. with automatic differentiation)
+        const std::vector<float>& initial_xs, 				//! center of the starting points
+        float radius,							//! starting points are drawn from initial_xs +- radius
+        int number_of_starts,						//! number of independent runs
+        const std::function<float(int)>& learning_rate_schedule,	//! function that determines the learning rate based on the iteration nr
+        int max_number_of_iterations = 16348,				//! maximum number of iterations per run
+        float cancel_margin = 1.0f,					//! how much worse than the best a run may be before it is cancelled
+        int check_interval = 32					//! number of iterations between comparisons with the best
+    )
+    {
+        assert(number_of_starts >= 1);
+        assert(radius >= 0);
+        assert(check_interval >= 1);
+
+        // starting points
+        auto& generator = rng::thread_generator();
+        std::vector<std::vector<float>> starts = {initial_xs};
+        for(int i=1; i<number_of_starts; i++)
+        {
+            auto xs = initial_xs;
+            for(auto& x : xs)
+            {
+                x += generator.uniform(-radius, radius);
+            }
+            starts.push_back(xs);
+        }
+
+        // best value so far over all runs
+        std::atomic<float> best(std::numeric_limits<float>::infinity());
+        auto publish = [&best](float y)
+        {
+            auto current = best.load();
+            while(y < current && !best.compare_exchange_weak(current, y))
+            {
+            }
+        };
+
+        // runs
+        std::vector<std::vector<float>> min_xs(number_of_starts);
+        std::vector<float> min_ys(number_of_starts);
+        parallel::default_pool().run(number_of_starts, [&](int i)
+        {
+            auto give_up = [&best, &publish, cancel_margin, check_interval](int iteration_nr, float y)
+            {
+                if((iteration_nr + 1) % check_interval != 0)
+                {
+                    return false;
+                }
+                publish(y);
+                auto b = best.load();
+                return y > b + cancel_margin * std::max(1.0f, fabsf(b));
+            };
+            optim::SGD<> sgd;
+            optim::FunctionSchedule schedule(learning_rate_schedule);
+            min_xs[i] = gradient_descent_loop(f, gradient, starts[i], schedule, sgd, max_number_of_iterations, true, true, give_up, min_ys[i]);
+            publish(min_ys[i]);
+        });
+
+        // best run
+        auto best_run = std::min_element(min_ys.begin(), min_ys.end()) - min_ys.begin();
+        return min_xs[best_run];
+    }
+
+    /*!
+     * Multi-start gradient descent (see above), with the gradient approximated with (central) finite differences.
+     */
+    template<typename F>
+    std::vector<float> multi_start_gradient_descent(
+        const F& f, 							//! function to perform gradient descent on
+        const std::vector<float>& initial_xs, 				//! center of the starting points
+        float radius,							//! starting points are drawn from initial_xs +- radius
+        int number_of_starts,						//! number of independent runs
+        const std::function<float(int)>& learning_rate_schedule,	//! function that determines the learning rate based on the iteration nr
+        int max_number_of_iterations = 16348,				//! maximum number of iterations per run
+        float cancel_margin = 1.0f,					//! how much worse than the best a run may be before it is cancelled
+        int check_interval = 32					//! number of iterations between comparisons with the best
+    )
+    {
+        return multi_start_gradient_descent(f, finite_difference_gradient(f), initial_xs, radius, number_of_starts, learning_rate_schedule,
+                                            max_number_of_iterations, cancel_margin, check_interval);
+    }
+
     /*!
      * Gradient descent is a first-order iterative optimization algorithm for finding a local minimum of a differentiable function.
      * To find a local minimum of a function using gradient descent, we take steps proportional to the negative of the gradient
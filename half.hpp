@@ -0,0 +1,165 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+namespace matrix
+{
+
+    /*!
+     * bfloat16 storage type: the upper 16 bits of an IEEE single precision float
+     * (8 exponent bits, 7 mantissa bits). Same range as float at half the memory,
+     * meant for storage only: arithmetic converts to float.
+     */
+    struct bfloat16
+    {
+        uint16_t bits;
+
+        bfloat16()
+            : bits(0)
+        {
+        }
+
+        bfloat16(float f)
+        {
+            uint32_t u;
+            memcpy(&u, &f, sizeof(u));
+            if((u & 0x7fffffffu) > 0x7f800000u)
+            {
+                // NaN, keep it quiet
+                bits = (u >> 16) | 0x0040u;
+                return;
+            }
+            // round to nearest, ties to even
+            u += 0x7fffu + ((u >> 16) & 1u);
+            bits = u >> 16;
+        }
+
+        operator float() const
+        {
+            uint32_t u = (uint32_t) bits << 16;
+            float f;
+            memcpy(&f, &u, sizeof(f));
+            return f;
+        }
+    };
+
+    /*!
+     * IEEE 754 half precision (float16) storage type (5 exponent bits, 10 mantissa bits).
+     * More precision than bfloat16 but a range of only +-65504, meant for storage only: arithmetic converts to float.
+     */
+    struct float16
+    {
+        uint16_t bits;
+
+        float16()
+            : bits(0)
+        {
+        }
+
+        float16(float f)
+        {
+            uint32_t u;
+            memcpy(&u, &f, sizeof(u));
+            uint32_t sign = (u >> 16) & 0x8000u;
+            uint32_t abs = u & 0x7fffffffu;
+            if(abs >= 0x7f800000u)
+            {
+                // inf or NaN
+                bits = sign | 0x7c00u | (abs > 0x7f800000u ? 0x0200u : 0u);
+                return;
+            }
+            if(abs >= 0x477ff000u)
+            {
+                // rounds to a value beyond the largest half, overflow to inf
+                bits = sign | 0x7c00u;
+                return;
+            }
+            if(abs < 0x38800000u)
+            {
+                // subnormal half (or zero): align the mantissa, including the implicit bit, and round to nearest even
+                if(abs < 0x33000000u)
+                {
+                    bits = sign;
+                    return;
+                }
+                uint32_t exponent = abs >> 23;
+                uint32_t mantissa = (abs & 0x007fffffu) | 0x00800000u;
+                uint32_t shift = 126 - exponent;
+                uint32_t half_mantissa = mantissa >> shift;
+                uint32_t remainder = mantissa & ((1u << shift) - 1u);
+                uint32_t halfway = 1u << (shift - 1);
+                if(remainder > halfway || (remainder == halfway && (half_mantissa & 1u)))
+                {
+                    half_mantissa++;
+                }
+                bits = sign | half_mantissa;
+                return;
+            }
+            // normal half: rebias the exponent and round the mantissa to nearest even
+            abs += ((uint32_t)(15 - 127) << 23) + 0x0fffu + ((abs >> 13) & 1u);
+            bits = sign | (abs >> 13);
+        }
+
+        operator float() const
+        {
+            uint32_t sign = (uint32_t)(bits & 0x8000u) << 16;
+            uint32_t exponent = (bits >> 10) & 0x1fu;
+            uint32_t mantissa = bits & 0x03ffu;
+            uint32_t u;
+            if(exponent == 0x1fu)
+            {
+                // inf or NaN
+                u = sign | 0x7f800000u | (mantissa << 13);
+            }
+            else if(exponent != 0)
+            {
+                u = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+            }
+            else if(mantissa == 0)
+            {
+                u = sign;
+            }
+            else
+            {
+                // subnormal half, normalize
+                exponent = 127 - 15 + 1;
+                while((mantissa & 0x0400u) == 0)
+                {
+                    mantissa <<= 1;
+                    exponent--;
+                }
+                u = sign | (exponent << 23) | ((mantissa & 0x03ffu) << 13);
+            }
+            float f;
+            memcpy(&f, &u, sizeof(f));
+            return f;
+        }
+    };
+
+    /*!
+     * Type used to compute with elements of type T:
+     * half-width storage types are computed with in float, other types in their own precision.
+     */
+    template<typename T>
+    struct accumulator
+    {
+        typedef T type;
+    };
+
+    template<>
+    struct accumulator<bfloat16>
+    {
+        typedef float type;
+    };
+
+    template<>
+    struct accumulator<float16>
+    {
+        typedef float type;
+    };
+
+    template<typename T>
+    using accumulator_type = typename accumulator<T>::type;
+
+}
@@ -0,0 +1,336 @@
+#pragma once
+
+#include <algorithm>
+#include <assert.h>
+#include <functional>
+#include <math.h>
+#include <vector>
+
+#include "derivative.hpp"
+
+namespace numeric
+{
+
+    /*
+     * dot product of two vectors, accumulated in double precision
+     */
+    double dot(const std::vector<float>& a, const std::vector<float>& b)
+    {
+        assert(a.size() == b.size());
+        auto sum = 0.0;
+        for(int i=0; i<a.size(); i++)
+        {
+            sum += (double) a[i] * b[i];
+        }
+        return sum;
+    }
+
+    /*
+     * a point on the search line xs + alpha * direction: its coordinates, value, gradient and directional derivative
+     */
+    struct LinePoint
+    {
+        float alpha;
+        std::vector<float> xs;
+        float y;
+        std::vector<float> ds;
+        double slope;
+    };
+
+    /*
+     * evaluate f and its gradient at xs + alpha * direction
+     */
+    void evaluate_line_point(
+        const std::function<float(std::vector<float>)>& f,
+        const GradientFunction& gradient,
+        const std::vector<float>& xs,
+        const std::vector<float>& direction,
+        float alpha,
+        LinePoint& point
+    )
+    {
+        point.alpha = alpha;
+        point.xs.resize(xs.size());
+        for(int i=0; i<xs.size(); i++)
+        {
+            point.xs[i] = xs[i] + alpha * direction[i];
+        }
+        point.y = f(point.xs);
+        gradient(point.xs, point.y, point.ds);
+        point.slope = dot(point.ds, direction);
+    }
+
+    /*!
+     * Line search for a step along a descent direction that satisfies the strong Wolfe conditions:
+     * sufficient decrease, f(xs + alpha * d) <= f(xs) + c1 * alpha * slope, and curvature, |slope(alpha)| <= c2 * |slope|.
+     * Steps are expanded until the minimum is bracketed, then the bracket is narrowed (zoom) with safeguarded cubic interpolation.
+     * Returns false if no such step was found within the evaluation budget (start keeps the original point then).
+     */
+    bool wolfe_line_search(
+        const std::function<float(std::vector<float>)>& f,	//! function to minimize
+        const GradientFunction& gradient,			//! gradient of f
+        const LinePoint& start,				//! starting point (alpha 0), with its value, gradient and slope
+        const std::vector<float>& direction,			//! descent direction (start.slope < 0)
+        LinePoint& out,					//! the accepted point
+        float initial_alpha = 1.0f,				//! first trial step
+        float c1 = 1e-4f,					//! sufficient decrease constant
+        float c2 = 0.9f,					//! curvature constant
+        int max_number_of_evaluations = 32			//! evaluation budget
+    )
+    {
+        assert(start.slope < 0);
+        assert(0 < c1 && c1 < c2 && c2 < 1);
+
+        // does a point satisfy the sufficient decrease / curvature conditions
+        auto decreases = [&start, c1](const LinePoint& p)
+        {
+            return p.y <= start.y + c1 * p.alpha * start.slope;
+        };
+        auto flat = [&start, c2](const LinePoint& p)
+        {
+            return fabs(p.slope) <= -c2 * start.slope;
+        };
+
+        // minimizer of the cubic through two points with their slopes, safeguarded towards the middle of the bracket
+        auto interpolate = [](const LinePoint& lo, const LinePoint& hi)
+        {
+            auto a = lo.alpha;
+            auto b = hi.alpha;
+            auto d1 = lo.slope + hi.slope - 3.0 * (lo.y - hi.y) / (a - b);
+            auto s = d1 * d1 - lo.slope * hi.slope;
+            double alpha = 0.5 * (a + b);
+            if(s >= 0)
+            {
+                auto d2 = (b > a ? 1.0 : -1.0) * sqrt(s);
+                alpha = b - (b - a) * (hi.slope + d2 - d1) / (hi.slope - lo.slope + 2.0 * d2);
+            }
+            auto margin = 0.1 * fabs(b - a);
+            if(!(alpha > std::min(a, b) + margin && alpha < std::max(a, b) - margin))
+            {
+                alpha = 0.5 * (a + b);
+            }
+            return (float) alpha;
+        };
+
+        // bracketing phase
+        LinePoint previous = start;
+        LinePoint lo, hi;
+        auto alpha = initial_alpha;
+        auto evaluations = 0;
+        auto bracketed = false;
+        while(evaluations < max_number_of_evaluations)
+        {
+            evaluate_line_point(f, gradient, start.xs, direction, alpha, out);
+            evaluations++;
+            if(!decreases(out) || (evaluations > 1 && out.y >= previous.y))
+            {
+                lo = previous;
+                hi = out;
+                bracketed = true;
+                break;
+            }
+            if(flat(out))
+            {
+                return true;
+            }
+            if(out.slope >= 0)
+            {
+                lo = out;
+                hi = previous;
+                bracketed = true;
+                break;
+            }
+            previous = out;
+            alpha *= 2.0f;
+        }
+        if(!bracketed)
+        {
+            return false;
+        }
+
+        // zoom phase: lo always satisfies sufficient decrease and has the lowest value so far
+        while(evaluations < max_number_of_evaluations)
+        {
+            alpha = interpolate(lo, hi);
+            if(alpha == lo.alpha || alpha == hi.alpha)
+            {
+                break;
+            }
+            evaluate_line_point(f, gradient, start.xs, direction, alpha, out);
+            evaluations++;
+            if(!decreases(out) || out.y >= lo.y)
+            {
+                hi = out;
+            }
+            else
+            {
+                if(flat(out))
+                {
+                    return true;
+                }
+                if(out.slope * (hi.alpha - lo.alpha) >= 0)
+                {
+                    hi = lo;
+                }
+                lo = out;
+            }
+        }
+
+        // out of budget: accept the best point if it decreased f at all
+        if(lo.alpha != 0.0f && lo.y < start.y)
+        {
+            out = lo;
+            return true;
+        }
+        return false;
+    }
+
+    /*!
+     * Limited-memory BFGS (L-BFGS) is a quasi-Newton method: it approximates the inverse Hessian of f
+     * from the last few steps and gradient changes (history_size pairs), and takes steps along the resulting direction
+     * with a strong Wolfe line search. On smooth functions it typically converges in tens of iterations
+     * where fixed-step gradient descent needs thousands.
+     * Stops when the gradient is small (|ds|_inf <= gradient_tolerance * max(1, |xs|_inf)),
+     * when an iteration decreases f by less than function_tolerance (relative), or after max_number_of_iterations.
+     */
+    std::vector<float> lbfgs(
+        const std::function<float(std::vector<float>)>& f,	//! function to minimize
+        const GradientFunction& gradient,			//! function that computes the gradient of f (e.g. with automatic differentiation)
+        const std::vector<float>& initial_xs,			//! initial guess for the (local) minimum
+        int max_number_of_iterations = 100,			//! maximum number of iterations
+        int history_size = 8,					//! number of past steps used to approximate the inverse Hessian
+        float gradient_tolerance = 1e-5f,			//! stop when the largest partial derivative is this small (relative to xs)
+        float function_tolerance = 1e-7f			//! stop when an iteration improves f by less than this (relative)
+    )
+    {
+        assert(history_size >= 1);
+        int n = initial_xs.size();
+
+        // current point
+        LinePoint current;
+        current.alpha = 0.0f;
+        current.xs = initial_xs;
+        current.y = f(current.xs);
+        gradient(current.xs, current.y, current.ds);
+
+        // history of steps s = xs_k+1 - xs_k and gradient changes y = ds_k+1 - ds_k, oldest first
+        std::vector<std::vector<float>> ss;
+        std::vector<std::vector<float>> ys;
+        std::vector<double> rhos;
+        std::vector<double> alphas(history_size);
+
+        std::vector<float> direction(n);
+        LinePoint next;
+        for(int k=0; k<max_number_of_iterations; k++)
+        {
+
+            // converged?
+            auto ds_max = 0.0f;
+            auto xs_max = 1.0f;
+            for(int i=0; i<n; i++)
+            {
+                ds_max = std::max(ds_max, fabsf(current.ds[i]));
+                xs_max = std::max(xs_max, fabsf(current.xs[i]));
+            }
+            if(ds_max <= gradient_tolerance * xs_max)
+            {
+                break;
+            }
+
+            // direction = -H * ds, with the two-loop recursion
+            for(int i=0; i<n; i++)
+            {
+                direction[i] = current.ds[i];
+            }
+            for(int j=ss.size() - 1; j>=0; j--)
+            {
+                alphas[j] = rhos[j] * dot(ss[j], direction);
+                for(int i=0; i<n; i++)
+                {
+                    direction[i] -= alphas[j] * ys[j][i];
+                }
+            }
+            // initial inverse Hessian: scaled identity (the first step has length 1)
+            auto gamma = ss.empty() ? 1.0 / sqrt(dot(current.ds, current.ds)) : dot(ss.back(), ys.back()) / dot(ys.back(), ys.back());
+            for(int i=0; i<n; i++)
+            {
+                direction[i] *= gamma;
+            }
+            for(int j=0; j<ss.size(); j++)
+            {
+                auto beta = rhos[j] * dot(ys[j], direction);
+                for(int i=0; i<n; i++)
+                {
+                    direction[i] += ss[j][i] * (alphas[j] - beta);
+                }
+            }
+            for(int i=0; i<n; i++)
+            {
+                direction[i] = -direction[i];
+            }
+            current.slope = dot(current.ds, direction);
+
+            // line search, falling back to steepest descent once if the direction or the search fails
+            auto found = current.slope < 0 && wolfe_line_search(f, gradient, current, direction, next);
+            if(!found)
+            {
+                if(ss.empty())
+                {
+                    break;
+                }
+                ss.clear();
+                ys.clear();
+                rhos.clear();
+                continue;
+            }
+
+            // remember the step and the change in gradient, if the curvature is positive
+            std::vector<float> s(n), y(n);
+            for(int i=0; i<n; i++)
+            {
+                s[i] = next.xs[i] - current.xs[i];
+                y[i] = next.ds[i] - current.ds[i];
+            }
+            auto sy = dot(s, y);
+            if(sy > 1e-10 * dot(y, y))
+            {
+                if(ss.size() == history_size)
+                {
+                    ss.erase(ss.begin());
+                    ys.erase(ys.begin());
+                    rhos.erase(rhos.begin());
+                }
+                ss.push_back(std::move(s));
+                ys.push_back(std::move(y));
+                rhos.push_back(1.0 / sy);
+            }
+
+            // converged?
+            auto decrease = current.y - next.y;
+            std::swap(current, next);
+            current.alpha = 0.0f;
+            if(decrease <= function_tolerance * std::max({1.0f, fabsf(current.y), fabsf(next.y)}))
+            {
+                break;
+            }
+        }
+
+        return current.xs;
+    }
+
+    /*!
+     * L-BFGS (see above), with the gradient approximated by (central) finite differences.
+     */
+    std::vector<float> lbfgs(
+        const std::function<float(std::vector<float>)>& f,	//! function to minimize
+        const std::vector<float>& initial_xs,			//! initial guess for the (local) minimum
+        int max_number_of_iterations = 100,			//! maximum number of iterations
+        int history_size = 8,					//! number of past steps used to approximate the inverse Hessian
+        float gradient_tolerance = 1e-5f,			//! stop when the largest partial derivative is this small (relative to xs)
+        float function_tolerance = 1e-7f			//! stop when an iteration improves f by less than this (relative)
+    )
+    {
+        return lbfgs(f, finite_difference_gradient(f), initial_xs, max_number_of_iterations, history_size, gradient_tolerance, function_tolerance);
+    }
+
+}
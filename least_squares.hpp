@@ -0,0 +1,256 @@
+#pragma once
+
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+#include <utility>
+#include <vector>
+
+#include "matrix.hpp"
+
+namespace numeric
+{
+
+    /*!
+     * Methods to solve a linear least squares problem min |X c - ys|^2:
+     * qr       : Householder QR with column pivoting of X, numerically robust, handles rank deficient X
+     *            (coefficients of dependent columns are set to zero)
+     * cholesky : Cholesky factorization of the normal equations X^T X c = X^T ys, about twice as fast,
+     *            but squares the condition number of X (falls back to qr when X^T X is not positive definite)
+     */
+    enum class LeastSquaresMethod
+    {
+        qr,
+        cholesky
+    };
+
+    /*
+     * least squares with Householder QR with column pivoting, on a row-major m x p matrix (in double precision)
+     */
+    std::vector<double> least_squares_qr(std::vector<double> a, std::vector<double> b, int m, int p, double tolerance)
+    {
+        assert(a.size() == m * p);
+        assert(b.size() == m);
+        std::vector<int> permutation(p);
+        for(int j=0; j<p; j++)
+        {
+            permutation[j] = j;
+        }
+        auto column_norm = [&a, m, p](int j, int k)
+        {
+            auto sum = 0.0;
+            for(int i=k; i<m; i++)
+            {
+                sum += a[i * p + j] * a[i * p + j];
+            }
+            return sqrt(sum);
+        };
+
+        // reduce column k, for the remaining column with the largest norm
+        int rank = 0;
+        double first_pivot = 0.0;
+        std::vector<double> v(m);
+        for(int k=0; k<std::min(m, p); k++)
+        {
+
+            // pivot
+            int pivot = k;
+            auto pivot_norm = column_norm(k, k);
+            for(int j=k + 1; j<p; j++)
+            {
+                auto norm = column_norm(j, k);
+                if(norm > pivot_norm)
+                {
+                    pivot = j;
+                    pivot_norm = norm;
+                }
+            }
+            if(k == 0)
+            {
+                first_pivot = pivot_norm;
+            }
+            if(pivot_norm == 0.0 || pivot_norm <= tolerance * first_pivot)
+            {
+                break;
+            }
+            if(pivot != k)
+            {
+                for(int i=0; i<m; i++)
+                {
+                    std::swap(a[i * p + k], a[i * p + pivot]);
+                }
+                std::swap(permutation[k], permutation[pivot]);
+            }
+
+            // householder reflection v that maps column k onto -sign(a_kk) |column k| e_k
+            auto alpha = a[k * p + k] > 0 ? -pivot_norm : pivot_norm;
+            auto v_norm = 0.0;
+            for(int i=k; i<m; i++)
+            {
+                v[i] = a[i * p + k] - (i == k ? alpha : 0.0);
+                v_norm += v[i] * v[i];
+            }
+            if(v_norm > 0.0)
+            {
+                for(int j=k; j<p; j++)
+                {
+                    auto dot = 0.0;
+                    for(int i=k; i<m; i++)
+                    {
+                        dot += v[i] * a[i * p + j];
+                    }
+                    auto scale = 2.0 * dot / v_norm;
+                    for(int i=k; i<m; i++)
+                    {
+                        a[i * p + j] -= scale * v[i];
+                    }
+                }
+                auto dot = 0.0;
+                for(int i=k; i<m; i++)
+                {
+                    dot += v[i] * b[i];
+                }
+                auto scale = 2.0 * dot / v_norm;
+                for(int i=k; i<m; i++)
+                {
+                    b[i] -= scale * v[i];
+                }
+            }
+            rank++;
+        }
+
+        // back substitution R c = Q^T b on the independent columns, the others get zero
+        std::vector<double> c(p, 0.0);
+        for(int k=rank - 1; k>=0; k--)
+        {
+            auto sum = b[k];
+            for(int j=k + 1; j<rank; j++)
+            {
+                sum -= a[k * p + j] * c[j];
+            }
+            c[k] = sum / a[k * p + k];
+        }
+        std::vector<double> out(p, 0.0);
+        for(int j=0; j<p; j++)
+        {
+            out[permutation[j]] = c[j];
+        }
+        return out;
+    }
+
+    /*!
+     * Solve the linear least squares problem min |X c - ys|^2 + ridge |c|^2 for the coefficients c, in a single pass
+     * of O(rows * cols^2) operations, in double precision. The rows of X are the datapoints, its columns the features
+     * (add a column of ones for an intercept; note that ridge penalizes it as well).
+     */
+    std::vector<float> least_squares(
+        const matrix::BasicMatrix<float>& X,				//! design matrix (datapoints x features)
+        const std::vector<float>& ys,					//! targets
+        LeastSquaresMethod method = LeastSquaresMethod::qr,		//! factorization
+        float ridge = 0.0f,						//! ridge (Tikhonov) regularization strength
+        float tolerance = 1e-10f					//! relative size below which a pivot counts as zero (qr)
+    )
+    {
+        int m = X.rows();
+        int p = X.cols();
+        assert(m == ys.size());
+        assert(p >= 1);
+        assert(ridge >= 0);
+
+        std::vector<double> c;
+        if(method == LeastSquaresMethod::cholesky)
+        {
+
+            // normal equations G c = X^T ys, with G = X^T X + ridge I
+            std::vector<double> g(p * p, 0.0);
+            std::vector<double> rhs(p, 0.0);
+            for(int i=0; i<m; i++)
+            {
+                for(int j=0; j<p; j++)
+                {
+                    double x_j = X(i, j);
+                    rhs[j] += x_j * ys[i];
+                    for(int k=0; k<=j; k++)
+                    {
+                        g[j * p + k] += x_j * X(i, k);
+                    }
+                }
+            }
+            for(int j=0; j<p; j++)
+            {
+                g[j * p + j] += ridge;
+            }
+
+            // G = L L^T, in the lower triangle of g
+            auto positive_definite = true;
+            for(int j=0; j<p && positive_definite; j++)
+            {
+                auto d = g[j * p + j];
+                for(int k=0; k<j; k++)
+                {
+                    d -= g[j * p + k] * g[j * p + k];
+                }
+                if(d <= 1e-12 * std::max(1.0, fabs(g[j * p + j])))
+                {
+                    positive_definite = false;
+                    break;
+                }
+                g[j * p + j] = sqrt(d);
+                for(int i=j + 1; i<p; i++)
+                {
+                    auto sum = g[i * p + j];
+                    for(int k=0; k<j; k++)
+                    {
+                        sum -= g[i * p + k] * g[j * p + k];
+                    }
+                    g[i * p + j] = sum / g[j * p + j];
+                }
+            }
+
+            // L z = rhs, L^T c = z
+            if(positive_definite)
+            {
+                c = rhs;
+                for(int i=0; i<p; i++)
+                {
+                    for(int k=0; k<i; k++)
+                    {
+                        c[i] -= g[i * p + k] * c[k];
+                    }
+                    c[i] /= g[i * p + i];
+                }
+                for(int i=p - 1; i>=0; i--)
+                {
+                    for(int k=i + 1; k<p; k++)
+                    {
+                        c[i] -= g[k * p + i] * c[k];
+                    }
+                    c[i] /= g[i * p + i];
+                }
+            }
+        }
+        if(c.empty())
+        {
+
+            // QR of X, with sqrt(ridge) I appended below it for the ridge penalty
+            int rows = ridge > 0 ? m + p : m;
+            std::vector<double> a(rows * p, 0.0);
+            std::vector<double> b(rows, 0.0);
+            for(int i=0; i<m; i++)
+            {
+                for(int j=0; j<p; j++)
+                {
+                    a[i * p + j] = X(i, j);
+                }
+                b[i] = ys[i];
+            }
+            for(int j=0; ridge > 0 && j<p; j++)
+            {
+                a[(m + j) * p + j] = sqrt(ridge);
+            }
+            c = least_squares_qr(a, b, rows, p, tolerance);
+        }
+        return std::vector<float>(c.begin(), c.end());
+    }
+
+}
@@ -1,145 +1,512 @@
 
 #pragma once
 
+#include <algorithm>
 #include <assert.h>
 #include <functional>
 #include <iostream>
 #include <math.h>
 #include <stdlib.h>
+#include <type_traits>
 #include <vector>
 
+#include "dual.hpp"
+#include "var.hpp"
 #include "gradient_descent.hpp"
+#include "lbfgs.hpp"
+#include "least_squares.hpp"
+#include "minibatch.hpp"
+#include "models.hpp"
 
 namespace numeric
 {
 
     /*!
-     * In statistics, linear regression is a linear approach to modeling the relationship
-     * between a scalar response (or dependent variable) and one or more explanatory variables (or independent variables).
-     * The case of one explanatory variable is called simple linear regression.
+     * Methods to fit the parameters of a regression:
+     * gradient_descent : gradient descent with the learning rate schedule, on batches of the data
+     * lbfgs            : L-BFGS with a line search on the whole data (the learning rate schedule is not used),
+     *                    for smooth losses, converging in far fewer iterations
+     * least_squares    : a direct least squares solve on the whole data (see least_squares.hpp), in a single pass;
+     *                    requires a prediction function that is linear in its parameters and a (mean) squared error loss;
+     *                    QR or Cholesky, optionally with ridge regularization (see the least_squares_method and ridge arguments)
+     * automatic        : least_squares when the prediction function and the loss allow it (checked numerically), gradient_descent otherwise
      */
-    std::vector<float> linear_regression(
-        const std::vector<std::vector<float>>& xs,								//! xs datapoints
-        const std::vector<float>& ys,										//! ys datapoints
-        const std::function<float(std::vector<float>, std::vector<float>)>& pred_function,			//! function that attempts to predict relationship between xs and ys
-        const std::vector<float>& initial_params,								//! initial parameters for the prediction function
-        const std::function<float(std::vector<float>, std::vector<float>)>& loss_function,			//! loss function (cost the algorithm has to pay for bad predictions)
-        const std::function<float(int)>& learning_rate_schedule = step_decay_learning_rate(1.0f, 0.5f, 1024),	//! learning rate schedule (passed to gradient descent)
-        int max_number_of_iterations = 16384,									//! maximum number of iterations (passed to gradient descent)
-        int batch_size = -1											//! batch size
-    )
+    enum class Solver
     {
+        gradient_descent,
+        lbfgs,
+        least_squares,
+        automatic
+    };
 
-        // asserts
-        assert(xs.size() > 0);
-        assert(ys.size() > 0);
-        assert(xs.size() == ys.size());
-        assert(batch_size == -1 || batch_size > 0);
-        for(int i=0; i<xs.size(); i++)
+    /*
+     * try to write the prediction function as pred(params, x) = offset(x) + sum_j params[j] * design(x, j):
+     * returns false if pred is not linear in its parameters (checked at two probe parameter vectors on every datapoint)
+     */
+    template<typename Pred>
+    bool linear_design(
+        const Pred& pred_function,
+        const std::vector<float>& xs,		// datapoints, row after row
+        int dims,
+        int number_of_params,
+        matrix::BasicMatrix<float>& design,
+        std::vector<float>& offsets
+    )
+    {
+        int n = dims == 0 ? 0 : xs.size() / dims;
+        design.resize(n, number_of_params);
+        offsets.resize(n);
+        std::vector<float> params(number_of_params, 0.0f);
+        std::vector<std::vector<float>> probes(2, std::vector<float>(number_of_params));
+        for(int j=0; j<number_of_params; j++)
         {
-            assert(xs[0].size() == xs[i].size());
+            probes[0][j] = 1.0f - 0.5f * (j % 3);
+            probes[1][j] = 0.25f * (j % 5) - 0.75f;
         }
-
-        // obtain iteration nr
-        auto iteration_nr = 0;
-        auto lrs = [&learning_rate_schedule, &iteration_nr](int i)
+        for(int i=0; i<n; i++)
         {
-            iteration_nr = i;
-            return learning_rate_schedule(i);
-        };
+            matrix::Span<const float> x(xs.data() + i * dims, dims);
+            offsets[i] = pred_function(params, x);
+            for(int j=0; j<number_of_params; j++)
+            {
+                params[j] = 1.0f;
+                design(i, j) = pred_function(params, x) - offsets[i];
+                params[j] = 0.0f;
+            }
+            for(auto& probe : probes)
+            {
+                float y = pred_function(probe, x);
+                auto linear_y = offsets[i];
+                auto magnitude = fabsf(y) + fabsf(offsets[i]);
+                for(int j=0; j<number_of_params; j++)
+                {
+                    linear_y += probe[j] * design(i, j);
+                    magnitude += fabsf(probe[j] * design(i, j));
+                }
+                if(!(fabsf(y - linear_y) <= 1e-4f * (1.0f + magnitude)))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
 
-        // build function to be passed to gradient descent
-        if(batch_size == -1)
+    /*
+     * is the loss function proportional to the sum of squared errors (e.g. the mean squared error)?
+     * (checked at two probe predictions of different shape and size)
+     */
+    template<typename Loss>
+    bool squared_error(const Loss& loss_function, const std::vector<float>& ys)
+    {
+        std::vector<float> ratios;
+        for(int k=0; k<2; k++)
         {
-            batch_size=xs.size();
+            std::vector<float> pred_ys(ys.size());
+            auto sum = 0.0f;
+            for(int i=0; i<ys.size(); i++)
+            {
+                auto d = k == 0 ? 0.5f + 0.25f * (i % 3) : 3.0f - 1.5f * (i % 2);
+                pred_ys[i] = ys[i] + d;
+                sum += d * d;
+            }
+            float loss = loss_function(matrix::Span<const float>(ys), pred_ys);
+            ratios.push_back(loss / sum);
         }
-        auto f = [&pred_function, &loss_function, &xs, &ys, &iteration_nr, batch_size](std::vector<float> params)
+        return ratios[0] > 0 && fabsf(ratios[0] - ratios[1]) <= 1e-3f * ratios[0];
+    }
+
+    /*
+     * loss of a prediction function over the current batch of datapoints (all of them when the batch is empty),
+     * callable with parameters of any scalar type S the prediction and loss functions accept (float, or dual numbers).
+     * The datapoints are stored contiguously (row after row, dims values each) and handed to the prediction and loss functions as spans,
+     * so evaluating all of them copies no data; the rows and targets of a batch are gathered into buffers.
+     * Batch predictors (see models.hpp) predict the whole block at once, other prediction functions are called row by row.
+     */
+    template<typename Pred, typename Loss>
+    struct BatchLoss
+    {
+        const std::vector<float>& xs;
+        int dims;
+        const std::vector<float>& ys;
+        const Pred& pred_function;
+        const Loss& loss_function;
+        const matrix::Span<const int>& batch;
+
+        template<typename S>
+        S operator()(const std::vector<S>& params) const
         {
 
-            // batch logic here
-            auto start_index = (iteration_nr * batch_size) % ys.size();
-            auto stop_index = std::min(start_index + batch_size, ys.size());
+            // the rows and targets of the batch, contiguous (buffers are kept per thread, and per scalar type for the hypotheses)
+            matrix::Span<const float> block(xs);
+            matrix::Span<const float> ys_t(ys);
+            if(batch.size() > 0)
+            {
+                thread_local std::vector<float> xs_b;
+                thread_local std::vector<float> ys_b;
+                xs_b.resize(batch.size() * dims);
+                ys_b.resize(batch.size());
+                for(int k=0; k<batch.size(); k++)
+                {
+                    std::copy(xs.data() + batch[k] * dims, xs.data() + (batch[k] + 1) * dims, xs_b.data() + k * dims);
+                    ys_b[k] = ys[batch[k]];
+                }
+                block = matrix::Span<const float>(xs_b);
+                ys_t = matrix::Span<const float>(ys_b);
+            }
 
             // run prediction function
-            std::vector<float> ys_t;		// truth
-            std::vector<float> ys_h;		// hypothesis
-            for(int i=start_index; i!=stop_index; i=( i + 1 % ys.size()) )
+            thread_local std::vector<S> ys_h;
+            ys_h.resize(ys_t.size());
+            if constexpr(is_batch_predictor<Pred, S>::value)
             {
-                auto y_t = ys[i];
-                auto y_h = pred_function(params, xs[i]);
-                ys_t.push_back(y_t);
-                ys_h.push_back(y_h);
+                pred_function.predict(params, block, dims, matrix::Span<S>(ys_h));
+            }
+            else
+            {
+                for(int i=0; i<ys_t.size(); i++)
+                {
+                    ys_h[i] = pred_function(params, matrix::Span<const float>(block.data() + i * dims, dims));
+                }
             }
 
             // run loss function
-            auto loss = loss_function(ys_t, ys_h);
+            S loss = loss_function(ys_t, ys_h);
 
             // return
             return loss;
-        };
-
-        // pass function to gradient descent
-        auto out_params = gradient_descent(f, initial_params, lrs, max_number_of_iterations);
+        }
+    };
 
-        /*
-         * try a small range of 'pretty' coefficients near the ones that gradient descent found
-         */
-        auto N = 1;
-        std::vector<std::vector<float>> pretty_params_ops;
-        for(int i=0; i<out_params.size(); i++)
+    /*!
+     * Greedy search for 'pretty' parameters near params: every round evaluates, for every parameter that is not an integer yet,
+     * the current parameters with it rounded down and with it rounded up, and keeps the best of those candidates
+     * if it lowers f. Stops when no candidate helps or after budget evaluations of f (0 disables the search, -1 means no cap;
+     * the search needs at most N (N + 1) evaluations for N parameters anyway).
+     * The loss of the incumbent is cached. With parallel set, the candidates of a round are evaluated concurrently on the thread pool
+     * when that is worth it (cost_per_evaluation is the approximate work of an evaluation of f): f must then be safe to call concurrently.
+     */
+    template<typename F>
+    std::vector<float> pretty_params_search(const F& f, const std::vector<float>& params, int budget = 256, bool parallel = false, long cost_per_evaluation = 1)
+    {
+        assert(budget >= -1);
+        if(budget == 0)
         {
-            auto p = out_params[i];
-            if(p == floor(p))
+            return params;
+        }
+        auto out_params = params;
+        float loss = f(out_params);
+        auto evaluations = 1;
+        std::vector<std::vector<float>> candidates;
+        std::vector<float> losses;
+        while(budget == -1 || evaluations < budget)
+        {
+
+            // candidates: one parameter rounded down or up, as far as the budget allows
+            candidates.clear();
+            for(int j=0; j<out_params.size(); j++)
             {
-                pretty_params_ops.push_back({p});
+                auto p = out_params[j];
+                if(p == floor(p))
+                {
+                    continue;
+                }
+                for(auto rounded : {floorf(p), ceilf(p)})
+                {
+                    if(budget == -1 || evaluations + candidates.size() < budget)
+                    {
+                        candidates.push_back(out_params);
+                        candidates.back()[j] = rounded;
+                    }
+                }
             }
-            else
+            if(candidates.empty())
             {
-                pretty_params_ops.push_back(
+                break;
+            }
+
+            // evaluate them
+            losses.resize(candidates.size());
+            auto evaluate = [&f, &candidates, &losses](int begin, int end)
+            {
+                for(int i=begin; i<end; i++)
                 {
-                    floor(p),	// p rounded up
-                    ceil(p), 	// p rounded down
-                    p
-                });		// p itself
-                N *= 3;
+                    losses[i] = f(candidates[i]);
+                }
+            };
+            if(parallel)
+            {
+                parallel::parallel_for(0, candidates.size(), cost_per_evaluation, evaluate);
+            }
+            else
+            {
+                evaluate(0, candidates.size());
+            }
+            evaluations += candidates.size();
+
+            // keep the best, if it improves on the incumbent
+            auto best = std::min_element(losses.begin(), losses.end()) - losses.begin();
+            if(!(losses[best] < loss))
+            {
+                break;
             }
+            loss = losses[best];
+            out_params = candidates[best];
+        }
+        return out_params;
+    }
+
+    /*
+     * fit the parameters of a batch loss with gradient descent (on mini-batches, or on all data),
+     * then search for 'pretty' coefficients near the ones that gradient descent found (see pretty_params_search)
+     */
+    template<typename Mode, typename Pred, typename Loss>
+    std::vector<float> fit_batch_loss(
+        const std::vector<std::vector<float>>& xs,
+        const std::vector<float>& ys,
+        const Pred& pred_function,
+        const std::vector<float>& initial_params,
+        const Loss& loss_function,
+        const std::function<float(int)>& learning_rate_schedule,
+        int max_number_of_iterations,
+        int batch_size,
+        Solver solver,
+        LastBatch last_batch,
+        int pretty_search_budget,
+        bool parallel,
+        LeastSquaresMethod least_squares_method,
+        float ridge
+    )
+    {
+
+        // asserts
+        assert(xs.size() > 0);
+        assert(ys.size() > 0);
+        assert(xs.size() == ys.size());
+        assert(batch_size == -1 || batch_size > 0);
+        assert(solver != Solver::lbfgs || batch_size == -1 || batch_size >= xs.size());
+        for(int i=0; i<xs.size(); i++)
+        {
+            assert(xs[0].size() == xs[i].size());
         }
-        std::vector<int> M;
-        for(int i=0; i<out_params.size(); i++)
+
+        // store the datapoints contiguously
+        int dims = xs[0].size();
+        std::vector<float> flat_xs;
+        flat_xs.reserve(xs.size() * dims);
+        for(auto& x : xs)
         {
-            M.push_back(0);
+            flat_xs.insert(flat_xs.end(), x.begin(), x.end());
         }
-        for(int i=0; i<N; i++)
+
+        // build function to be passed to gradient descent (on all data, until a batch is selected)
+        if(batch_size == -1 || batch_size >= xs.size())
         {
+            batch_size = xs.size();
+        }
+        matrix::Span<const int> batch;
+        BatchLoss<Pred, Loss> f {flat_xs, dims, ys, pred_function, loss_function, batch};
 
-            // build 'pretty' params
-            auto pretty_params = out_params;
-            for(int j=0; j<M.size(); j++)
+        // gradient with finite differences, or with (forward or reverse mode) automatic differentiation
+        auto gradient = [&f]()
+        {
+            if constexpr(std::is_same<Mode, FiniteDifferences>::value)
+            {
+                return finite_difference_gradient(f);
+            }
+            else
             {
-                pretty_params[j] = pretty_params_ops[j][M[j]];
+                return [&f](const std::vector<float>& params, float loss, std::vector<float>& ds)
+                {
+                    autodiff::gradient(Mode(), f, params, ds);
+                };
             }
+        }();
 
-            // calculate loss
-            auto loss = f(pretty_params);
-            if(loss < f(out_params))
+        // a squared error of a model that is linear in its parameters is minimized by a direct least squares solve
+        std::vector<float> out_params;
+        if(solver == Solver::least_squares || solver == Solver::automatic)
+        {
+            matrix::BasicMatrix<float> design;
+            std::vector<float> targets;
+            auto linear = linear_design(pred_function, flat_xs, dims, initial_params.size(), design, targets) && squared_error(loss_function, ys);
+            assert(linear || solver == Solver::automatic);
+            if(linear)
             {
-                out_params = pretty_params;
+                for(int i=0; i<ys.size(); i++)
+                {
+                    targets[i] = ys[i] - targets[i];
+                }
+                out_params = least_squares(design, targets, least_squares_method, ridge);
             }
+            else
+            {
+                solver = Solver::gradient_descent;
+            }
+        }
 
-            // update index (moving to next configuration of pretty params
-            M[0]++;
-            for(int j=0; j<M.size(); j++)
+        // pass function to gradient descent (or L-BFGS)
+        if(solver == Solver::lbfgs)
+        {
+            out_params = lbfgs(f, gradient, initial_params, max_number_of_iterations);
+        }
+        else if(solver == Solver::gradient_descent && batch_size == xs.size())
+        {
+            out_params = gradient_descent(f, gradient, initial_params, learning_rate_schedule, max_number_of_iterations);
+        }
+        else if(solver == Solver::gradient_descent)
+        {
+
+            // mini-batch gradient descent: every step descends along the gradient of the loss on one batch (of a shuffled epoch),
+            // the loss on all data is evaluated at the end of every epoch to keep the best parameters
+            MiniBatches batches(xs.size(), batch_size, true, last_batch);
+            optim::SGD<> sgd;
+            auto params = initial_params;
+            std::vector<float> ds;
+            out_params = params;
+            auto best_loss = f(params);
+            for(int step=0; step<max_number_of_iterations; step++)
             {
-                if(M[j] == pretty_params_ops[j].size() && j < M.size() - 1)
+                auto learning_rate = learning_rate_schedule(step);
+                if(learning_rate < pow(10, -16))
                 {
-                    M[j] = 0;
-                    M[j+1]++;
+                    break;
+                }
+                batch = batches.batch(step);
+                gradient(params, 0.0f, ds);	// the loss itself is only used by forward differences
+                sgd.update(0, params, ds, learning_rate);
+                if((step + 1) % batches.batches_per_epoch() == 0 || step + 1 == max_number_of_iterations)
+                {
+                    batch = matrix::Span<const int>();
+                    auto loss = f(params);
+                    if(loss < best_loss)
+                    {
+                        best_loss = loss;
+                        out_params = params;
+                    }
                 }
             }
+            batch = matrix::Span<const int>();
         }
 
-        // return
-        return out_params;
+        // try 'pretty' coefficients near the ones that were found (not for a ridge solve: the loss does not include its penalty)
+        if((solver == Solver::least_squares || solver == Solver::automatic) && ridge > 0)
+        {
+            return out_params;
+        }
+        return pretty_params_search(f, out_params, pretty_search_budget, parallel, (long) xs.size() * (dims + 1));
+    }
+
+    /*!
+     * In statistics, linear regression is a linear approach to modeling the relationship
+     * between a scalar response (or dependent variable) and one or more explanatory variables (or independent variables).
+     * The case of one explanatory variable is called simple linear regression.
+     * The prediction and loss functions can be any callables, so that they can be inlined into the batch loop:
+     * pred_function(const std::vector<float>& params, matrix::Span<const float> xs) returns a float,
+     * loss_function(matrix::Span<const float> ys, const std::vector<float>& pred_ys) returns a float.
+     * The functions are called from the calling thread only, unless parallel is set: the candidates of the 'pretty' coefficient search
+     * are then evaluated concurrently on the thread pool, so the functions must be safe to call concurrently (in every overload below).
+     */
+    template<typename Pred, typename Loss>
+    std::vector<float> linear_regression(
+        const std::vector<std::vector<float>>& xs,								//! xs datapoints
+        const std::vector<float>& ys,										//! ys datapoints
+        const Pred& pred_function,										//! function that attempts to predict relationship between xs and ys
+        const std::vector<float>& initial_params,								//! initial parameters for the prediction function
+        const Loss& loss_function,										//! loss function (cost the algorithm has to pay for bad predictions)
+        const std::function<float(int)>& learning_rate_schedule = step_decay_learning_rate(1.0f, 0.5f, 1024),	//! learning rate schedule (passed to gradient descent)
+        int max_number_of_iterations = 16384,									//! maximum number of iterations (passed to gradient descent)
+        int batch_size = -1,											//! batch size (-1 for all data), batches are drawn from a shuffled permutation every epoch
+        Solver solver = Solver::gradient_descent,								//! method to fit the parameters with
+        LastBatch last_batch = LastBatch::partial,								//! what to do with the last batch of an epoch (mini-batches only)
+        int pretty_search_budget = 256,										//! maximum number of loss evaluations to search for 'pretty' coefficients (0 disables)
+        bool parallel = false,											//! flag to determine whether to evaluate the 'pretty' coefficient candidates concurrently
+        LeastSquaresMethod least_squares_method = LeastSquaresMethod::qr,					//! factorization of the direct solve (least squares solver only)
+        float ridge = 0.0f											//! ridge regularization strength of the direct solve (least squares solver only)
+    )
+    {
+        return fit_batch_loss<FiniteDifferences>(xs, ys, pred_function, initial_params, loss_function, learning_rate_schedule, max_number_of_iterations, batch_size, solver, last_batch, pretty_search_budget, parallel, least_squares_method, ridge);
+    }
+
+    /*!
+     * Linear regression (see above) with std::functions; the spans of datapoints are copied into vectors.
+     */
+    std::vector<float> linear_regression(
+        const std::vector<std::vector<float>>& xs,								//! xs datapoints
+        const std::vector<float>& ys,										//! ys datapoints
+        const std::function<float(std::vector<float>, std::vector<float>)>& pred_function,			//! function that attempts to predict relationship between xs and ys
+        const std::vector<float>& initial_params,								//! initial parameters for the prediction function
+        const std::function<float(std::vector<float>, std::vector<float>)>& loss_function,			//! loss function (cost the algorithm has to pay for bad predictions)
+        const std::function<float(int)>& learning_rate_schedule = step_decay_learning_rate(1.0f, 0.5f, 1024),	//! learning rate schedule (passed to gradient descent)
+        int max_number_of_iterations = 16384,									//! maximum number of iterations (passed to gradient descent)
+        int batch_size = -1,											//! batch size (-1 for all data), batches are drawn from a shuffled permutation every epoch
+        Solver solver = Solver::gradient_descent,								//! method to fit the parameters with
+        LastBatch last_batch = LastBatch::partial,								//! what to do with the last batch of an epoch (mini-batches only)
+        int pretty_search_budget = 256,										//! maximum number of loss evaluations to search for 'pretty' coefficients (0 disables)
+        bool parallel = false,											//! flag to determine whether to evaluate the 'pretty' coefficient candidates concurrently
+        LeastSquaresMethod least_squares_method = LeastSquaresMethod::qr,					//! factorization of the direct solve (least squares solver only)
+        float ridge = 0.0f											//! ridge regularization strength of the direct solve (least squares solver only)
+    )
+    {
+        return linear_regression<std::function<float(std::vector<float>, std::vector<float>)>, std::function<float(std::vector<float>, std::vector<float>)>>(
+                   xs, ys, pred_function, initial_params, loss_function, learning_rate_schedule, max_number_of_iterations, batch_size, solver, last_batch, pretty_search_budget, parallel, least_squares_method, ridge);
+    }
+
+    /*!
+     * Linear regression with gradients from forward-mode automatic differentiation instead of finite differences.
+     * The prediction and loss functions must be generic in the parameter type S (float, or dual numbers):
+     * pred_function(const std::vector<S>& params, matrix::Span<const float> xs) returns an S,
+     * loss_function(matrix::Span<const float> ys, const std::vector<S>& pred_ys) returns an S.
+     * A gradient then costs one evaluation of the loss per 8 parameters, instead of two per parameter.
+     */
+    template<typename Pred, typename Loss>
+    std::vector<float> linear_regression(
+        autodiff::ForwardMode,											//! tag selecting forward-mode automatic differentiation
+        const std::vector<std::vector<float>>& xs,								//! xs datapoints
+        const std::vector<float>& ys,										//! ys datapoints
+        const Pred& pred_function,										//! generic function that attempts to predict relationship between xs and ys
+        const std::vector<float>& initial_params,								//! initial parameters for the prediction function
+        const Loss& loss_function,										//! generic loss function (cost the algorithm has to pay for bad predictions)
+        const std::function<float(int)>& learning_rate_schedule = step_decay_learning_rate(1.0f, 0.5f, 1024),	//! learning rate schedule (passed to gradient descent)
+        int max_number_of_iterations = 16384,									//! maximum number of iterations (passed to gradient descent)
+        int batch_size = -1,											//! batch size (-1 for all data), batches are drawn from a shuffled permutation every epoch
+        Solver solver = Solver::gradient_descent,								//! method to fit the parameters with
+        LastBatch last_batch = LastBatch::partial,								//! what to do with the last batch of an epoch (mini-batches only)
+        int pretty_search_budget = 256,										//! maximum number of loss evaluations to search for 'pretty' coefficients (0 disables)
+        bool parallel = false,											//! flag to determine whether to evaluate the 'pretty' coefficient candidates concurrently
+        LeastSquaresMethod least_squares_method = LeastSquaresMethod::qr,					//! factorization of the direct solve (least squares solver only)
+        float ridge = 0.0f											//! ridge regularization strength of the direct solve (least squares solver only)
+    )
+    {
+        return fit_batch_loss<autodiff::ForwardMode>(xs, ys, pred_function, initial_params, loss_function, learning_rate_schedule, max_number_of_iterations, batch_size, solver, last_batch, pretty_search_budget, parallel, least_squares_method, ridge);
+    }
+
+    /*!
+     * Linear regression with gradients from reverse-mode automatic differentiation: the loss over a batch is recorded once
+     * and a single backward pass yields the whole gradient, for models with many parameters.
+     * The prediction and loss functions must be generic in the parameter type S (float, or autodiff::Var),
+     * with the same signatures as for forward mode.
+     */
+    template<typename Pred, typename Loss>
+    std::vector<float> linear_regression(
+        autodiff::ReverseMode,											//! tag selecting reverse-mode automatic differentiation
+        const std::vector<std::vector<float>>& xs,								//! xs datapoints
+        const std::vector<float>& ys,										//! ys datapoints
+        const Pred& pred_function,										//! generic function that attempts to predict relationship between xs and ys
+        const std::vector<float>& initial_params,								//! initial parameters for the prediction function
+        const Loss& loss_function,										//! generic loss function (cost the algorithm has to pay for bad predictions)
+        const std::function<float(int)>& learning_rate_schedule = step_decay_learning_rate(1.0f, 0.5f, 1024),	//! learning rate schedule (passed to gradient descent)
+        int max_number_of_iterations = 16384,									//! maximum number of iterations (passed to gradient descent)
+        int batch_size = -1,											//! batch size (-1 for all data), batches are drawn from a shuffled permutation every epoch
+        Solver solver = Solver::gradient_descent,								//! method to fit the parameters with
+        LastBatch last_batch = LastBatch::partial,								//! what to do with the last batch of an epoch (mini-batches only)
+        int pretty_search_budget = 256,										//! maximum number of loss evaluations to search for 'pretty' coefficients (0 disables)
+        bool parallel = false,											//! flag to determine whether to evaluate the 'pretty' coefficient candidates concurrently
+        LeastSquaresMethod least_squares_method = LeastSquaresMethod::qr,					//! factorization of the direct solve (least squares solver only)
+        float ridge = 0.0f											//! ridge regularization strength of the direct solve (least squares solver only)
+    )
+    {
+        return fit_batch_loss<autodiff::ReverseMode>(xs, ys, pred_function, initial_params, loss_function, learning_rate_schedule, max_number_of_iterations, batch_size, solver, last_batch, pretty_search_budget, parallel, least_squares_method, ridge);
     }
 
 }
@@ -3,11 +3,12 @@
 #include <assert.h>
 #include <functional>
 #include <math.h>
-#include <stdlib.h>
-#include <time.h>
 #include <vector>
 
 #include "linear_regression.hpp"
+#include "models.hpp"
+#include "reductions.hpp"
+#include "rng.hpp"
 
 namespace numeric
 {
@@ -33,43 +34,17 @@ namespace numeric
             assert(xs[0].size() == xs[i].size());
         }
 
-        // prediction function
-        auto pred_function = [](std::vector<float> coeffs, std::vector<float> xs)
-        {
-            auto h = 0.0;
-            for(int i=0; i<xs.size(); i++)
-            {
-                h += xs[i] * coeffs[i];
-            }
-            h += coeffs[coeffs.size() - 1];
-            auto z = 1.0f / (1.0f + exp(-h));
-            return z;
-        };
-
-        // loss function
-        auto loss_function = [&pred_function](std::vector<float> ys, std::vector<float> pred_ys)
-        {
-            auto loss = 0.0;
-            for(int i=0; i<ys.size(); i++)
-            {
-                auto pred_y = std::min(std::max(pred_ys[i], 0.001f), 0.999f);
-                loss += (-ys[i] * log(pred_y) - (1.0f - ys[i]) * log(1.0f - pred_y));
-            }
-            loss /= ys.size();
-            return loss;
-        };
-
         // build initial params
-        srand(time(NULL));
+        auto& generator = rng::thread_generator();
         std::vector<float> coeffs;
         for(int i=0; i<=xs[0].size(); i++)
         {
-            auto p = (rand() % 100) / 1000.0f;
-            coeffs.push_back(0.0f);
+            auto p = generator.uniform(0.0f, 0.1f);
+            coeffs.push_back(p);
         }
 
-        // delegate
-        return linear_regression(xs, ys, pred_function, coeffs, loss_function, step_decay_learning_rate(0.9f, 0.99f, 128), 16348);
+        // delegate, with the built-in logistic model and cross-entropy loss (the loss is smooth, so L-BFGS converges in tens of iterations)
+        return linear_regression(autodiff::forward_mode, xs, ys, LogisticModel(), coeffs, CrossEntropy(), step_decay_learning_rate(0.9f, 0.99f, 128), 200, -1, Solver::lbfgs);
 
     }
 }
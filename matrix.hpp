@@ -1,251 +1,1425 @@
 #pragma once
 
+#include <algorithm>
 #include <assert.h>
 #include <functional>
+#include <initializer_list>
 #include <iostream>
 #include <math.h>
-#include <stdlib.h>     /* srand, rand */
-#include <time.h>       /* time */
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "gemm.hpp"
+#include "half.hpp"
+#include "rng.hpp"
+#include "thread_pool.hpp"
+
 namespace matrix
 {
 
-    typedef std::vector<std::vector<float>> FloatMatrix;
+    /*!
+     * A non-owning view on a row or a column of a matrix.
+     * Consecutive elements of the view are 'stride' elements apart in the underlying storage,
+     * which makes it possible to look at a column of a row-major matrix without copying it.
+     */
+    template<typename T>
+    class VectorView
+    {
+        public:
+
+            VectorView(T* data, int size, int stride = 1)
+                : data_(data), size_(size), stride_(stride)
+            {
+                assert(size >= 0);
+                assert(stride >= 1);
+            }
+
+            int size() const
+            {
+                return size_;
+            }
+
+            int stride() const
+            {
+                return stride_;
+            }
+
+            T* data() const
+            {
+                return data_;
+            }
+
+            T& operator[](int i) const
+            {
+                assert(i >= 0);
+                assert(i < size_);
+                return data_[i * stride_];
+            }
+
+            /*! copy the elements of the view into a vector
+             */
+            operator std::vector<typename std::remove_const<T>::type>() const
+            {
+                std::vector<typename std::remove_const<T>::type> out(size_);
+                for(int i=0; i<size_; i++)
+                {
+                    out[i] = data_[i * stride_];
+                }
+                return out;
+            }
+
+        private:
+
+            T* data_;
+            int size_;
+            int stride_;
+    };
+
+    /*!
+     * A view on a contiguous range of elements (a pointer and a size), e.g. one row of a dataset.
+     * Spans are passed by value instead of copying vectors, and index without a stride so that loops over them inline fully.
+     */
+    template<typename T>
+    class Span
+    {
+        public:
+
+            typedef typename std::remove_const<T>::type value_type;
+
+            Span()
+                : data_(nullptr), size_(0)
+            {
+            }
+
+            Span(T* data, int size)
+                : data_(data), size_(size)
+            {
+                assert(size >= 0);
+            }
+
+            Span(std::vector<value_type>& v)
+                : data_(v.data()), size_(v.size())
+            {
+            }
+
+            /*! a read-only span on a vector
+             */
+            template<typename U = T, typename = typename std::enable_if<std::is_const<U>::value>::type>
+            Span(const std::vector<value_type>& v)
+                : data_(v.data()), size_(v.size())
+            {
+            }
+
+            int size() const
+            {
+                return size_;
+            }
+
+            T* data() const
+            {
+                return data_;
+            }
+
+            T& operator[](int i) const
+            {
+                assert(i >= 0);
+                assert(i < size_);
+                return data_[i];
+            }
+
+            T* begin() const
+            {
+                return data_;
+            }
+
+            T* end() const
+            {
+                return data_ + size_;
+            }
+
+            /*! copy the elements of the span into a vector
+             */
+            operator std::vector<value_type>() const
+            {
+                return std::vector<value_type>(data_, data_ + size_);
+            }
+
+        private:
+
+            T* data_;
+            int size_;
+    };
+
+    /*!
+     * Base class of all lazily evaluated matrix expressions (expression templates).
+     * An expression E provides rows(), cols() and operator()(int i), which computes the i-th element (in row-major order).
+     * Nothing is computed until an expression is assigned to a Matrix, at which point the whole expression
+     * is evaluated in a single loop, without intermediate matrices.
+     */
+    template<typename E>
+    struct Expression
+    {
+        const E& self() const
+        {
+            return static_cast<const E&>(*this);
+        }
+    };
+
+    /*!
+     * evaluate an expression into a buffer of e.rows() * e.cols() elements
+     * elements are computed in the precision of the expression and rounded to T once, when they are stored
+     */
+    template<typename E, typename T>
+    void evaluate(const E& e, T* out)
+    {
+        parallel::parallel_for(0, e.rows() * e.cols(), 1, [&e, out](int begin, int end)
+        {
+            for(int i=begin; i<end; i++)
+            {
+                out[i] = static_cast<T>(e(i));
+            }
+        });
+    }
+
+    /*!
+     * A dense matrix, stored contiguously in row-major order.
+     * Element (i, j) lives at data()[i * cols() + j], so every row is a contiguous block of memory
+     * and the whole matrix is a single heap allocation.
+     * T is the storage type of the elements: float, double, or one of the half-width types bfloat16 and float16,
+     * which halve memory and bandwidth while all arithmetic on them is done in float (see accumulator in half.hpp).
+     */
+    template<typename T>
+    class BasicMatrix
+    {
+        public:
+
+            typedef T value_type;
+
+            BasicMatrix()
+                : rows_(0), cols_(0)
+            {
+            }
+
+            BasicMatrix(int rows, int cols, T value = T(0.0f))
+                : rows_(rows), cols_(cols), data_(rows * cols, value)
+            {
+                assert(rows >= 0);
+                assert(cols >= 0);
+            }
+
+            /*! build a matrix from a vector of rows (all rows must be of equal length)
+             * the elements are converted to T
+             */
+            template<typename U>
+            BasicMatrix(const std::vector<std::vector<U>>& m)
+                : rows_(m.size()), cols_(m.size() == 0 ? 0 : m[0].size())
+            {
+                data_.reserve(rows_ * cols_);
+                for(int i=0; i<rows_; i++)
+                {
+                    assert(m[i].size() == cols_);
+                    for(int j=0; j<cols_; j++)
+                    {
+                        data_.push_back(static_cast<T>(m[i][j]));
+                    }
+                }
+            }
+
+            /*! build a matrix from a list of rows (all rows must be of equal length)
+             */
+            BasicMatrix(std::initializer_list<std::vector<T>> m)
+                : BasicMatrix(std::vector<std::vector<T>>(m))
+            {
+            }
+
+            /*! evaluate an expression into a new matrix
+             */
+            template<typename E>
+            BasicMatrix(const Expression<E>& e)
+                : rows_(e.self().rows()), cols_(e.self().cols()), data_(rows_ * cols_)
+            {
+                evaluate(e.self(), data_.data());
+            }
+
+            /*! evaluate an expression into this matrix
+             * elementwise expressions may refer to the matrix they are assigned to (e.g. w = w + s * g)
+             */
+            template<typename E>
+            BasicMatrix& operator=(const Expression<E>& e)
+            {
+                if(e.self().rows() != rows_ || e.self().cols() != cols_)
+                {
+                    BasicMatrix tmp(e);
+                    std::swap(*this, tmp);
+                    return *this;
+                }
+                evaluate(e.self(), data_.data());
+                return *this;
+            }
+
+            template<typename U>
+            BasicMatrix& operator+=(const U& u)
+            {
+                return *this = *this + u;
+            }
+
+            template<typename U>
+            BasicMatrix& operator-=(const U& u)
+            {
+                return *this = *this - u;
+            }
+
+            BasicMatrix& operator*=(double s)
+            {
+                return *this = s * *this;
+            }
+
+            /*! change the dimensions of the matrix, reusing its storage when it is large enough
+             * (elements are not preserved in any meaningful order)
+             */
+            void resize(int rows, int cols)
+            {
+                assert(rows >= 0);
+                assert(cols >= 0);
+                rows_ = rows;
+                cols_ = cols;
+                data_.resize(rows * cols);
+            }
+
+            int rows() const
+            {
+                return rows_;
+            }
+
+            int cols() const
+            {
+                return cols_;
+            }
+
+            int size() const
+            {
+                return rows_ * cols_;
+            }
+
+            T* data()
+            {
+                return data_.data();
+            }
+
+            const T* data() const
+            {
+                return data_.data();
+            }
+
+            T& operator()(int i, int j)
+            {
+                assert(i >= 0 && i < rows_);
+                assert(j >= 0 && j < cols_);
+                return data_[i * cols_ + j];
+            }
+
+            T operator()(int i, int j) const
+            {
+                assert(i >= 0 && i < rows_);
+                assert(j >= 0 && j < cols_);
+                return data_[i * cols_ + j];
+            }
+
+            /*! return a view on the i-th row
+             */
+            VectorView<T> row(int i)
+            {
+                assert(i >= 0 && i < rows_);
+                return VectorView<T>(data_.data() + i * cols_, cols_, 1);
+            }
+
+            VectorView<const T> row(int i) const
+            {
+                assert(i >= 0 && i < rows_);
+                return VectorView<const T>(data_.data() + i * cols_, cols_, 1);
+            }
+
+            /*! return a (strided) view on the j-th column
+             */
+            VectorView<T> col(int j)
+            {
+                assert(j >= 0 && j < cols_);
+                return VectorView<T>(data_.data() + j, rows_, cols_ == 0 ? 1 : cols_);
+            }
+
+            VectorView<const T> col(int j) const
+            {
+                assert(j >= 0 && j < cols_);
+                return VectorView<const T>(data_.data() + j, rows_, cols_ == 0 ? 1 : cols_);
+            }
+
+            /*! m[i][j] is shorthand for m.row(i)[j]
+             */
+            VectorView<T> operator[](int i)
+            {
+                return row(i);
+            }
+
+            VectorView<const T> operator[](int i) const
+            {
+                return row(i);
+            }
+
+        private:
+
+            int rows_;
+            int cols_;
+            std::vector<T> data_;
+    };
+
+    typedef BasicMatrix<float> Matrix;
+    typedef Matrix FloatMatrix;
+    typedef BasicMatrix<double> DoubleMatrix;
+    typedef BasicMatrix<bfloat16> BFloat16Matrix;
+    typedef BasicMatrix<float16> Float16Matrix;
+
+    /*!
+     * Leaf of an expression, refers to the elements of a matrix (which must outlive the expression).
+     * Elements are read in the accumulator type of T, so half-width matrices take part in expressions as floats.
+     */
+    template<typename T>
+    struct Terminal : public Expression<Terminal<T>>
+    {
+        Terminal(const BasicMatrix<T>& m)
+            : data(m.data()), rows_(m.rows()), cols_(m.cols())
+        {
+        }
+
+        Terminal(const T* data, int rows, int cols)
+            : data(data), rows_(rows), cols_(cols)
+        {
+        }
+
+        int rows() const
+        {
+            return rows_;
+        }
+
+        int cols() const
+        {
+            return cols_;
+        }
+
+        accumulator_type<T> operator()(int i) const
+        {
+            return data[i];
+        }
+
+        const T* data;
+        int rows_;
+        int cols_;
+    };
+
+    /*!
+     * Elementwise combination of two expressions of the same dimensions.
+     * The result has the usual arithmetic type of both sides, so float combined with double is computed in double.
+     */
+    template<typename Op, typename L, typename R>
+    struct BinaryExpression : public Expression<BinaryExpression<Op, L, R>>
+    {
+        BinaryExpression(const L& l, const R& r)
+            : l(l), r(r)
+        {
+            assert(l.rows() == r.rows());
+            assert(l.cols() == r.cols());
+        }
+
+        int rows() const
+        {
+            return l.rows();
+        }
+
+        int cols() const
+        {
+            return l.cols();
+        }
+
+        auto operator()(int i) const
+        {
+            return Op::apply(l(i), r(i));
+        }
+
+        L l;
+        R r;
+    };
+
+    /*!
+     * An expression multiplied by a scalar (held in the precision of the expression).
+     */
+    template<typename L>
+    struct ScaledExpression : public Expression<ScaledExpression<L>>
+    {
+        typedef decltype(std::declval<const L&>()(0)) value_type;
+
+        ScaledExpression(const L& l, double s)
+            : l(l), s(static_cast<value_type>(s))
+        {
+        }
+
+        int rows() const
+        {
+            return l.rows();
+        }
+
+        int cols() const
+        {
+            return l.cols();
+        }
+
+        value_type operator()(int i) const
+        {
+            return s * l(i);
+        }
+
+        L l;
+        value_type s;
+    };
+
+    /*!
+     * A function applied to each element of an expression.
+     */
+    template<typename L, typename F>
+    struct MappedExpression : public Expression<MappedExpression<L, F>>
+    {
+        MappedExpression(const L& l, const F& f)
+            : l(l), f(f)
+        {
+        }
+
+        int rows() const
+        {
+            return l.rows();
+        }
+
+        int cols() const
+        {
+            return l.cols();
+        }
+
+        auto operator()(int i) const
+        {
+            return f(l(i));
+        }
+
+        L l;
+        F f;
+    };
+
+    /*!
+     * A function applied to each pair of elements of two expressions of the same dimensions.
+     */
+    template<typename L, typename R, typename F>
+    struct ZippedExpression : public Expression<ZippedExpression<L, R, F>>
+    {
+        ZippedExpression(const L& l, const R& r, const F& f)
+            : l(l), r(r), f(f)
+        {
+            assert(l.rows() == r.rows());
+            assert(l.cols() == r.cols());
+        }
+
+        int rows() const
+        {
+            return l.rows();
+        }
+
+        int cols() const
+        {
+            return l.cols();
+        }
+
+        auto operator()(int i) const
+        {
+            return f(l(i), r(i));
+        }
+
+        L l;
+        R r;
+        F f;
+    };
+
+    struct AddOp
+    {
+        template<typename A, typename B>
+        static auto apply(A a, B b)
+        {
+            return a + b;
+        }
+    };
+
+    struct SubtractOp
+    {
+        template<typename A, typename B>
+        static auto apply(A a, B b)
+        {
+            return a - b;
+        }
+    };
+
+    struct MultiplyOp
+    {
+        template<typename A, typename B>
+        static auto apply(A a, B b)
+        {
+            return a * b;
+        }
+    };
+
+    /*
+     * anything that can take part in an expression: a matrix, or an expression
+     */
+    template<typename T>
+    struct is_matrix : std::false_type
+    {
+    };
+
+    template<typename T>
+    struct is_matrix<BasicMatrix<T>> : std::true_type
+    {
+    };
+
+    template<typename T>
+    struct is_operand
+    {
+        static const bool value = is_matrix<T>::value || std::is_base_of<Expression<T>, T>::value;
+    };
+
+    template<typename T>
+    Terminal<T> as_expression(const BasicMatrix<T>& m)
+    {
+        return Terminal<T>(m);
+    }
+
+    template<typename E>
+    const E& as_expression(const Expression<E>& e)
+    {
+        return e.self();
+    }
+
+    template<typename T>
+    using expression_type = typename std::decay<decltype(as_expression(std::declval<const T&>()))>::type;
+
+    /*! lazy elementwise sum
+     */
+    template<typename L, typename R, typename = typename std::enable_if<is_operand<L>::value && is_operand<R>::value>::type>
+    BinaryExpression<AddOp, expression_type<L>, expression_type<R>> operator+(const L& l, const R& r)
+    {
+        return {as_expression(l), as_expression(r)};
+    }
+
+    /*! lazy elementwise difference
+     */
+    template<typename L, typename R, typename = typename std::enable_if<is_operand<L>::value && is_operand<R>::value>::type>
+    BinaryExpression<SubtractOp, expression_type<L>, expression_type<R>> operator-(const L& l, const R& r)
+    {
+        return {as_expression(l), as_expression(r)};
+    }
+
+    /*! lazy elementwise (Hadamard) product
+     */
+    template<typename L, typename R, typename = typename std::enable_if<is_operand<L>::value && is_operand<R>::value>::type>
+    BinaryExpression<MultiplyOp, expression_type<L>, expression_type<R>> operator%(const L& l, const R& r)
+    {
+        return {as_expression(l), as_expression(r)};
+    }
+
+    /*! lazy multiplication by a scalar
+     */
+    template<typename L, typename = typename std::enable_if<is_operand<L>::value>::type>
+    ScaledExpression<expression_type<L>> operator*(double s, const L& l)
+    {
+        return {as_expression(l), s};
+    }
+
+    template<typename L, typename = typename std::enable_if<is_operand<L>::value>::type>
+    ScaledExpression<expression_type<L>> operator*(const L& l, double s)
+    {
+        return {as_expression(l), s};
+    }
+
+    /*! lazy application of a function to each element
+     */
+    template<typename L, typename F, typename = typename std::enable_if<is_operand<L>::value>::type>
+    MappedExpression<expression_type<L>, F> map(const L& l, const F& f)
+    {
+        return {as_expression(l), f};
+    }
+
+    /*! lazy application of a function to each pair of elements of two expressions
+     */
+    template<typename L, typename R, typename F, typename = typename std::enable_if<is_operand<L>::value && is_operand<R>::value>::type>
+    ZippedExpression<expression_type<L>, expression_type<R>, F> map(const L& l, const R& r, const F& f)
+    {
+        return {as_expression(l), as_expression(r), f};
+    }
+
+    /*! view a vector as a 1 x n matrix expression, without copying (the vector must outlive the expression)
+     */
+    template<typename T>
+    Terminal<T> as_row(const std::vector<T>& v)
+    {
+        return Terminal<T>(v.data(), 1, v.size());
+    }
+
+    template<typename T>
+    Terminal<typename Span<T>::value_type> as_row(const Span<T>& v)
+    {
+        return Terminal<typename Span<T>::value_type>(v.data(), 1, v.size());
+    }
+
+    /*! return a copy of a matrix with its elements converted to another type (e.g. cast<bfloat16>(m))
+     */
+    template<typename U, typename T>
+    BasicMatrix<U> cast(const BasicMatrix<T>& m)
+    {
+        return BasicMatrix<U>(as_expression(m));
+    }
 
     /*! return the number of rows in a matrix
      */
-    int rows(const FloatMatrix& m)
+    template<typename T>
+    int rows(const BasicMatrix<T>& m)
+    {
+        return m.rows();
+    }
+
+    /*! return the number of columns in a matrix
+     */
+    template<typename T>
+    int cols(const BasicMatrix<T>& m)
+    {
+        return m.cols();
+    }
+
+    /*! return a matrix of specified dimensions, filled with zeroes
+     */
+    template<typename T = float>
+    BasicMatrix<T> zero(int rows, int cols)
+    {
+        assert(rows >= 0);
+        assert(cols >= 0);
+        return BasicMatrix<T>(rows, cols, T(0.0f));
+    }
+
+    /*! return an identity matrix of specified dimensions
+     */
+    template<typename T = float>
+    BasicMatrix<T> eye(int rows, int cols)
+    {
+        assert(rows >= 0);
+        assert(cols >= 0);
+        auto out = zero<T>(rows, cols);
+        auto N = rows < cols ? rows : cols;
+        for(int i=0; i<N; i++)
+        {
+            out(i, i) = T(1.0f);
+        }
+        return out;
+    }
+
+    /*! return a matrix of specified dimensions, filled with elements from [0 .. 1)
+     */
+    template<typename T = float>
+    BasicMatrix<T> random(int rows, int cols, rng::Generator& generator)
+    {
+        assert(rows >= 0);
+        assert(cols >= 0);
+        BasicMatrix<T> out(rows, cols);
+        auto p = out.data();
+        for(int i=0; i<out.size(); i++)
+        {
+            p[i] = T(generator.uniform());
+        }
+        return out;
+    }
+
+    /*! return a matrix of specified dimensions, filled with elements from [0 .. 1), drawn from the generator of the calling thread
+     */
+    template<typename T = float>
+    BasicMatrix<T> random(int rows, int cols)
+    {
+        return random<T>(rows, cols, rng::thread_generator());
+    }
+
+    /*!
+     * Xavier (Glorot) initialization, for layers with a symmetric activation function such as the sigmoid or tanh.
+     * Returns a (fan_in x fan_out) weight matrix drawn uniformly from [-l .. l), with l = sqrt(6 / (fan_in + fan_out)).
+     */
+    template<typename T = float>
+    BasicMatrix<T> xavier(int fan_in, int fan_out, rng::Generator& generator = rng::thread_generator())
+    {
+        assert(fan_in > 0);
+        assert(fan_out > 0);
+        auto l = sqrt(6.0f / (fan_in + fan_out));
+        BasicMatrix<T> out(fan_in, fan_out);
+        auto p = out.data();
+        for(int i=0; i<out.size(); i++)
+        {
+            p[i] = T(generator.uniform(-l, l));
+        }
+        return out;
+    }
+
+    /*!
+     * He (Kaiming) initialization, for layers with a rectifier activation function.
+     * Returns a (fan_in x fan_out) weight matrix drawn from N(0, 2 / fan_in).
+     */
+    template<typename T = float>
+    BasicMatrix<T> he(int fan_in, int fan_out, rng::Generator& generator = rng::thread_generator())
+    {
+        assert(fan_in > 0);
+        assert(fan_out > 0);
+        auto stddev = sqrt(2.0f / fan_in);
+        BasicMatrix<T> out(fan_in, fan_out);
+        auto p = out.data();
+        for(int i=0; i<out.size(); i++)
+        {
+            p[i] = T(generator.normal(0.0f, stddev));
+        }
+        return out;
+    }
+
+    /*! copy rows [begin .. end) of a given matrix into out
+     */
+    template<typename T>
+    void slice_rows(const BasicMatrix<T>& m, int begin, int end, BasicMatrix<T>& out)
+    {
+        assert(begin >= 0);
+        assert(begin <= end);
+        assert(end <= rows(m));
+        out.resize(end - begin, cols(m));
+        std::copy(m.data() + begin * cols(m), m.data() + end * cols(m), out.data());
+    }
+
+    /*! return the matrix formed by rows [begin .. end) of a given matrix
+     */
+    template<typename T>
+    BasicMatrix<T> slice_rows(const BasicMatrix<T>& m, int begin, int end)
+    {
+        BasicMatrix<T> out;
+        slice_rows(m, begin, end, out);
+        return out;
+    }
+
+    /*! add two matrices of the same dimensions
+     */
+    template<typename T>
+    BasicMatrix<T> add(const BasicMatrix<T>& a, const BasicMatrix<T>& b)
+    {
+        assert(rows(a) == rows(b));
+        assert(cols(a) == cols(b));
+        return a + b;
+    }
+
+    /* subtract two matrices of the same dimensions
+     */
+    template<typename T>
+    BasicMatrix<T> subtract(const BasicMatrix<T>& a, const BasicMatrix<T>& b)
+    {
+        assert(rows(a) == rows(b));
+        assert(cols(a) == cols(b));
+        return a - b;
+    }
+
+    /*! calculate the elementwise product of two matrices of the same dimensions
+     */
+    template<typename T>
+    BasicMatrix<T> dotproduct(const BasicMatrix<T>& a, const BasicMatrix<T>& b)
+    {
+        assert(rows(a) == rows(b));
+        assert(cols(a) == cols(b));
+        return a % b;
+    }
+
+    /*! multiply each element in a specified matrix with a specified scalar
+     */
+    template<typename T>
+    BasicMatrix<T> scalar(const BasicMatrix<T>& a, double b)
+    {
+        assert(rows(a) > 0);
+        assert(cols(a) > 0);
+        return b * a;
+    }
+
+    template<typename T>
+    BasicMatrix<T> transpose(const BasicMatrix<T>& a)
     {
-        return m.size();
+        assert(rows(a) > 0);
+        assert(cols(a) > 0);
+        BasicMatrix<T> out(cols(a), rows(a));
+        for(int i=0; i<rows(a); i++)
+        {
+            auto row = a.data() + i * cols(a);
+            auto col = out.col(i);
+            for(int j=0; j<cols(a); j++)
+            {
+                col[j] = row[j];
+            }
+        }
+        return out;
     }
 
-    /*! return the number of columns in a matrix
+    /*
+     * resize out to M x N and call f with a zeroed buffer of accumulator_type<T> to accumulate a product into:
+     * out itself, or (for half-width T) a float buffer that is rounded into out once f is done
      */
-    int cols(const FloatMatrix& m)
+    template<typename T, typename F>
+    void accumulate(BasicMatrix<T>& out, int M, int N, const F& f)
     {
-        return m.size() == 0 ? 0 : m[0].size();
+        out.resize(M, N);
+        if constexpr(std::is_same<accumulator_type<T>, T>::value)
+        {
+            std::fill(out.data(), out.data() + out.size(), T(0.0f));
+            f(out.data());
+        }
+        else
+        {
+            thread_local std::vector<accumulator_type<T>> accumulator;
+            accumulator.assign(out.size(), 0.0f);
+            f(accumulator.data());
+            std::copy(accumulator.begin(), accumulator.end(), out.data());
+        }
     }
 
-    /*! return a matrix of specified dimensions, filled with zeroes
+    /*
+     * c += op(a) * op(b) with c zero-initialized, split over threads
+     * by rows of the output (or by columns, when there are few rows)
      */
-    FloatMatrix zero(int rows, int cols)
+    template<typename T, typename C>
+    void parallel_gemm(bool transpose_a, bool transpose_b, int M, int N, int K, const T* pa, int lda, const T* pb, int ldb, C* po)
     {
-        assert(rows >= 0);
-        assert(cols >= 0);
-        FloatMatrix out;
-        for(int i=0; i<rows; i++)
+        if(M >= N)
         {
-            std::vector<float> row;
-            for(int j=0; j<cols; j++)
+            parallel::parallel_for(0, M, (long) N * K, [=](int begin, int end)
             {
-                row.push_back(0.0f);
-            }
-            out.push_back(row);
+                auto a_begin = pa + (transpose_a ? begin : begin * lda);
+                gemm::gemm(transpose_a, transpose_b, end - begin, N, K, a_begin, lda, pb, ldb, po + begin * N, N);
+            });
+        }
+        else
+        {
+            parallel::parallel_for(0, N, (long) M * K, [=](int begin, int end)
+            {
+                auto b_begin = pb + (transpose_b ? begin * ldb : begin);
+                gemm::gemm(transpose_a, transpose_b, M, end - begin, K, pa, lda, b_begin, ldb, po + begin, N);
+            });
         }
-        return out;
     }
 
-    /*! return an identity matrix of specified dimensions
+    /*!
+     * Matrix multiplication of op(a) and op(b), where op(x) is x or its transpose (GEMM NN, NT, TN and TT forms).
+     * Transposed operands are read in place, so mul(a, b, true, false) == mul(transpose(a), b) without copying a.
+     * Delegated to the blocked and vectorized kernel in gemm.hpp.
+     * Large products are split over threads, by rows of the output (or by columns, when there are few rows).
+     * Half-width matrices are multiplied in float: products are accumulated in a float buffer and rounded to T once, at the end.
+     * The result is written to out, whose storage is reused when it is large enough (out must not be a or b).
      */
-    FloatMatrix eye(int rows, int cols)
+    template<typename T>
+    void mul(const BasicMatrix<T>& a, const BasicMatrix<T>& b, bool transpose_a, bool transpose_b, BasicMatrix<T>& out)
     {
-        assert(rows >= 0);
-        assert(cols >= 0);
-        auto out = zero(rows, cols);
-        auto N = rows > cols ? rows : cols;
-        for(int i=0; i<N; i++)
+        assert(rows(a) > 0);
+        assert(cols(a) > 0);
+        assert(rows(b) > 0);
+        assert(cols(b) > 0);
+        assert(&out != &a && &out != &b);
+        auto M = transpose_a ? cols(a) : rows(a);
+        auto K = transpose_a ? rows(a) : cols(a);
+        auto N = transpose_b ? rows(b) : cols(b);
+        assert(K == (transpose_b ? cols(b) : rows(b)));
+        accumulate(out, M, N, [&](accumulator_type<T>* po)
         {
-            out[i][i] = 1.0f;
-        }
+            parallel_gemm(transpose_a, transpose_b, M, N, K, a.data(), cols(a), b.data(), cols(b), po);
+        });
+    }
+
+    /*!
+     * Matrix multiplication of op(a) and op(b) (see above)
+     */
+    template<typename T>
+    BasicMatrix<T> mul(const BasicMatrix<T>& a, const BasicMatrix<T>& b, bool transpose_a, bool transpose_b)
+    {
+        BasicMatrix<T> out;
+        mul(a, b, transpose_a, transpose_b, out);
         return out;
     }
 
-    /*! return a matrix of specified dimensions, filled with elements from [0 .. 1]
+    /*!
+     * Matrix multiplication
      */
-    FloatMatrix random(int rows, int cols)
+    template<typename T>
+    BasicMatrix<T> mul(const BasicMatrix<T>& a, const BasicMatrix<T>& b)
     {
-        assert(rows >= 0);
-        assert(cols >= 0);
-        srand(time(NULL));
-        FloatMatrix out;
-        for(int i=0; i<rows; i++)
-        {
-            std::vector<float> row;
-            for(int j=0; j<cols; j++)
+        return mul(a, b, false, false);
+    }
+
+    /*!
+     * A sparse matrix in compressed sparse row (CSR) format.
+     * The non-zeros of row i are values()[row_offsets()[i] .. row_offsets()[i + 1]),
+     * in the columns given by col_indices() over the same range (increasing within a row).
+     * Storage, and the cost of products with dense matrices, scale with the number of non-zeros rather than with rows() * cols().
+     */
+    template<typename T>
+    class BasicSparseMatrix
+    {
+        public:
+
+            typedef T value_type;
+
+            /*! a non-zero element, to build a matrix from coordinate (COO) format
+             */
+            struct Triplet
+            {
+                int row;
+                int col;
+                T value;
+            };
+
+            BasicSparseMatrix()
+                : BasicSparseMatrix(0, 0)
             {
-                auto p = (rand() % 65536) / 65536.0f;
-                row.push_back(p);
             }
-            out.push_back(row);
-        }
-        return out;
+
+            /*! an all-zero matrix of specified dimensions
+             */
+            BasicSparseMatrix(int rows, int cols)
+                : rows_(rows), cols_(cols), row_offsets_(rows + 1, 0)
+            {
+                assert(rows >= 0);
+                assert(cols >= 0);
+            }
+
+            /*! build a matrix from its non-zeros in coordinate format, in any order (duplicates are summed)
+             */
+            BasicSparseMatrix(int rows, int cols, std::vector<Triplet> triplets)
+                : BasicSparseMatrix(rows, cols)
+            {
+                std::sort(triplets.begin(), triplets.end(), [](const Triplet& t0, const Triplet& t1)
+                {
+                    return t0.row < t1.row || (t0.row == t1.row && t0.col < t1.col);
+                });
+                for(int i=0; i<triplets.size(); i++)
+                {
+                    auto& t = triplets[i];
+                    assert(t.row >= 0 && t.row < rows);
+                    assert(t.col >= 0 && t.col < cols);
+                    if(i > 0 && t.row == triplets[i - 1].row && t.col == triplets[i - 1].col)
+                    {
+                        values_.back() = T((accumulator_type<T>) values_.back() + (accumulator_type<T>) t.value);
+                        continue;
+                    }
+                    col_indices_.push_back(t.col);
+                    values_.push_back(t.value);
+                    row_offsets_[t.row + 1]++;
+                }
+                for(int i=0; i<rows; i++)
+                {
+                    row_offsets_[i + 1] += row_offsets_[i];
+                }
+            }
+
+            /*! build a matrix from the non-zero elements of a dense matrix
+             */
+            explicit BasicSparseMatrix(const BasicMatrix<T>& m)
+                : BasicSparseMatrix(m.rows(), m.cols())
+            {
+                for(int i=0; i<rows_; i++)
+                {
+                    for(int j=0; j<cols_; j++)
+                    {
+                        if((accumulator_type<T>) m(i, j) != 0)
+                        {
+                            col_indices_.push_back(j);
+                            values_.push_back(m(i, j));
+                        }
+                    }
+                    row_offsets_[i + 1] = values_.size();
+                }
+            }
+
+            /*! change the dimensions and the number of non-zeros, reusing storage when it is large enough
+             * (the structure has to be filled in through row_offsets(), col_indices() and values() afterwards)
+             */
+            void resize(int rows, int cols, int non_zeros)
+            {
+                assert(rows >= 0);
+                assert(cols >= 0);
+                assert(non_zeros >= 0);
+                rows_ = rows;
+                cols_ = cols;
+                row_offsets_.resize(rows + 1);
+                col_indices_.resize(non_zeros);
+                values_.resize(non_zeros);
+            }
+
+            int rows() const
+            {
+                return rows_;
+            }
+
+            int cols() const
+            {
+                return cols_;
+            }
+
+            int non_zeros() const
+            {
+                return values_.size();
+            }
+
+            int* row_offsets()
+            {
+                return row_offsets_.data();
+            }
+
+            const int* row_offsets() const
+            {
+                return row_offsets_.data();
+            }
+
+            int* col_indices()
+            {
+                return col_indices_.data();
+            }
+
+            const int* col_indices() const
+            {
+                return col_indices_.data();
+            }
+
+            T* values()
+            {
+                return values_.data();
+            }
+
+            const T* values() const
+            {
+                return values_.data();
+            }
+
+        private:
+
+            int rows_;
+            int cols_;
+            std::vector<int> row_offsets_;
+            std::vector<int> col_indices_;
+            std::vector<T> values_;
+    };
+
+    typedef BasicSparseMatrix<float> SparseMatrix;
+
+    /*! return the number of rows in a sparse matrix
+     */
+    template<typename T>
+    int rows(const BasicSparseMatrix<T>& m)
+    {
+        return m.rows();
+    }
+
+    /*! return the number of columns in a sparse matrix
+     */
+    template<typename T>
+    int cols(const BasicSparseMatrix<T>& m)
+    {
+        return m.cols();
     }
 
-    /*! return the largest value from a given matrix
+    /*! return the dense equivalent of a sparse matrix
      */
-    float max(const FloatMatrix& m)
+    template<typename T>
+    BasicMatrix<T> dense(const BasicSparseMatrix<T>& m)
     {
-        assert(rows(m) > 0);
-        assert(cols(m) > 0);
-        auto out = m[0][0];
+        auto out = zero<T>(rows(m), cols(m));
+        auto offsets = m.row_offsets();
         for(int i=0; i<rows(m); i++)
         {
-            for(int j=0; j<cols(m); j++)
+            for(int p=offsets[i]; p<offsets[i + 1]; p++)
             {
-                out = m[i][j] > out ? m[i][j] : out;
+                out(i, m.col_indices()[p]) = m.values()[p];
             }
         }
         return out;
     }
 
-    /*! return the smallest value from a given matrix
+    /*! return the transpose of a sparse matrix (its CSR form is the CSC form of the original)
      */
-    float min(const FloatMatrix& m)
+    template<typename T>
+    BasicSparseMatrix<T> transpose(const BasicSparseMatrix<T>& m)
     {
-        assert(rows(m) > 0);
-        assert(cols(m) > 0);
-        auto out = m[0][0];
+        BasicSparseMatrix<T> out;
+        out.resize(cols(m), rows(m), m.non_zeros());
+        auto offsets = out.row_offsets();
+        std::fill(offsets, offsets + cols(m) + 1, 0);
+        for(int p=0; p<m.non_zeros(); p++)
+        {
+            offsets[m.col_indices()[p] + 1]++;
+        }
+        for(int j=0; j<cols(m); j++)
+        {
+            offsets[j + 1] += offsets[j];
+        }
+        // rows of m are visited in order, so the column indices of every row of out come out sorted
+        std::vector<int> next(offsets, offsets + cols(m));
         for(int i=0; i<rows(m); i++)
         {
-            for(int j=0; j<cols(m); j++)
+            for(int p=m.row_offsets()[i]; p<m.row_offsets()[i + 1]; p++)
             {
-                out = m[i][j] < out ? m[i][j] : out;
+                auto q = next[m.col_indices()[p]]++;
+                out.col_indices()[q] = i;
+                out.values()[q] = m.values()[p];
             }
         }
         return out;
     }
 
-    /*! add two matrices of the same dimensions
+    /*! copy rows [begin .. end) of a given sparse matrix into out
      */
-    FloatMatrix add(const FloatMatrix& a, const FloatMatrix& b)
+    template<typename T>
+    void slice_rows(const BasicSparseMatrix<T>& m, int begin, int end, BasicSparseMatrix<T>& out)
     {
-        assert(rows(a) == rows(b));
-        assert(cols(a) == cols(b));
-        FloatMatrix out;
-        for(int i=0; i<rows(a); i++)
+        assert(begin >= 0);
+        assert(begin <= end);
+        assert(end <= rows(m));
+        auto offsets = m.row_offsets();
+        out.resize(end - begin, cols(m), offsets[end] - offsets[begin]);
+        for(int i=begin; i<=end; i++)
         {
-            std::vector<float> row;
-            for(int j=0; j<cols(a); j++)
-            {
-                row.push_back(a[i][j] + b[i][j]);
-            }
-            out.push_back(row);
+            out.row_offsets()[i - begin] = offsets[i] - offsets[begin];
         }
-        return out;
+        std::copy(m.col_indices() + offsets[begin], m.col_indices() + offsets[end], out.col_indices());
+        std::copy(m.values() + offsets[begin], m.values() + offsets[end], out.values());
     }
 
-    /* subtract two matrices of the same dimensions
+    /*!
+     * Multiplication of a sparse and a dense matrix, op(a) * op(b), where op(x) is x or its transpose.
+     * Every non-zero of a costs one pass over a row of op(b), so the work is proportional to a.non_zeros() * cols(op(b)).
+     * Split over threads by rows of the output (or, when a is transposed and rows of out receive scattered updates, by columns).
+     * The result is written to out, whose storage is reused when it is large enough (out must not be b).
      */
-    FloatMatrix subtract(const FloatMatrix& a, const FloatMatrix& b)
+    template<typename T>
+    void mul(const BasicSparseMatrix<T>& a, const BasicMatrix<T>& b, bool transpose_a, bool transpose_b, BasicMatrix<T>& out)
     {
-        assert(rows(a) == rows(b));
-        assert(cols(a) == cols(b));
-        FloatMatrix out;
-        for(int i=0; i<rows(a); i++)
+        assert(&out != &b);
+        auto M = transpose_a ? cols(a) : rows(a);
+        auto K = transpose_a ? rows(a) : cols(a);
+        auto N = transpose_b ? rows(b) : cols(b);
+        assert(K == (transpose_b ? cols(b) : rows(b)));
+        auto rsb = transpose_b ? 1 : cols(b);
+        auto csb = transpose_b ? cols(b) : 1;
+        auto R = rows(a);
+        auto offsets = a.row_offsets();
+        auto indices = a.col_indices();
+        auto values = a.values();
+        auto pb = b.data();
+        accumulate(out, M, N, [&](accumulator_type<T>* po)
         {
-            std::vector<float> row;
-            for(int j=0; j<cols(a); j++)
+            if(!transpose_a)
             {
-                row.push_back(a[i][j] - b[i][j]);
+                // out(i, :) is the sum of a(i, k) * op(b)(k, :) over the non-zeros of row i
+                parallel::parallel_for(0, M, (long) N * (a.non_zeros() / std::max(M, 1) + 1), [=](int begin, int end)
+                {
+                    for(int i=begin; i<end; i++)
+                    {
+                        auto out_row = po + i * N;
+                        for(int p=offsets[i]; p<offsets[i + 1]; p++)
+                        {
+                            accumulator_type<T> v = values[p];
+                            auto b_row = pb + indices[p] * rsb;
+                            for(int j=0; j<N; j++)
+                            {
+                                out_row[j] += v * (accumulator_type<T>) b_row[j * csb];
+                            }
+                        }
+                    }
+                });
             }
-            out.push_back(row);
-        }
-        return out;
+            else
+            {
+                // every non-zero a(i, k) adds a(i, k) * op(b)(i, :) to out(k, :)
+                parallel::parallel_for(0, N, a.non_zeros(), [=](int begin, int end)
+                {
+                    for(int i=0; i<R; i++)
+                    {
+                        auto b_row = pb + i * rsb;
+                        for(int p=offsets[i]; p<offsets[i + 1]; p++)
+                        {
+                            accumulator_type<T> v = values[p];
+                            auto out_row = po + indices[p] * N;
+                            for(int j=begin; j<end; j++)
+                            {
+                                out_row[j] += v * (accumulator_type<T>) b_row[j * csb];
+                            }
+                        }
+                    }
+                });
+            }
+        });
     }
 
-    /*! calculate the elementwise product of two matrices of the same dimensions
+    /*!
+     * Multiplication of a dense and a sparse matrix, op(a) * op(b), where op(x) is x or its transpose
+     * (with transpose_a set, this is the dense-transpose times sparse product).
+     * Only the non-zeros of b are visited, for every row of the output. Split over threads by rows of the output.
+     * The result is written to out, whose storage is reused when it is large enough (out must not be a).
      */
-    FloatMatrix dotproduct(const FloatMatrix& a, const FloatMatrix& b)
+    template<typename T>
+    void mul(const BasicMatrix<T>& a, const BasicSparseMatrix<T>& b, bool transpose_a, bool transpose_b, BasicMatrix<T>& out)
     {
-        assert(rows(a) == rows(b));
-        assert(cols(a) == cols(b));
-        FloatMatrix out;
-        for(int i=0; i<rows(a); i++)
+        assert(&out != &a);
+        auto M = transpose_a ? cols(a) : rows(a);
+        auto K = transpose_a ? rows(a) : cols(a);
+        auto N = transpose_b ? rows(b) : cols(b);
+        assert(K == (transpose_b ? cols(b) : rows(b)));
+        auto rsa = transpose_a ? 1 : cols(a);
+        auto csa = transpose_a ? cols(a) : 1;
+        auto offsets = b.row_offsets();
+        auto indices = b.col_indices();
+        auto values = b.values();
+        auto pa = a.data();
+        accumulate(out, M, N, [&](accumulator_type<T>* po)
         {
-            std::vector<float> row;
-            for(int j=0; j<cols(a); j++)
+            parallel::parallel_for(0, M, (long) b.non_zeros() + K, [=](int begin, int end)
             {
-                row.push_back(a[i][j] * b[i][j]);
-            }
-            out.push_back(row);
-        }
+                for(int i=begin; i<end; i++)
+                {
+                    auto a_row = pa + i * rsa;
+                    auto out_row = po + i * N;
+                    if(!transpose_b)
+                    {
+                        // out(i, :) is the sum of op(a)(i, k) * b(k, :) over the rows k of b
+                        for(int k=0; k<K; k++)
+                        {
+                            accumulator_type<T> a_ik = a_row[k * csa];
+                            if(a_ik == 0)
+                            {
+                                continue;
+                            }
+                            for(int p=offsets[k]; p<offsets[k + 1]; p++)
+                            {
+                                out_row[indices[p]] += a_ik * (accumulator_type<T>) values[p];
+                            }
+                        }
+                    }
+                    else
+                    {
+                        // out(i, j) is the dot product of row i of op(a) with the sparse row j of b
+                        for(int j=0; j<N; j++)
+                        {
+                            accumulator_type<T> sum = 0;
+                            for(int p=offsets[j]; p<offsets[j + 1]; p++)
+                            {
+                                sum += (accumulator_type<T>) values[p] * (accumulator_type<T>) a_row[indices[p] * csa];
+                            }
+                            out_row[j] = sum;
+                        }
+                    }
+                }
+            });
+        });
+    }
+
+    /*!
+     * Multiplication of a sparse and a dense matrix, op(a) * op(b) (see above)
+     */
+    template<typename T>
+    BasicMatrix<T> mul(const BasicSparseMatrix<T>& a, const BasicMatrix<T>& b, bool transpose_a = false, bool transpose_b = false)
+    {
+        BasicMatrix<T> out;
+        mul(a, b, transpose_a, transpose_b, out);
         return out;
     }
 
-    /*! multiply each element in a specified matrix with a specified scalar
+    /*!
+     * Multiplication of a dense and a sparse matrix, op(a) * op(b) (see above)
      */
-    FloatMatrix scalar(const FloatMatrix& a, float b)
+    template<typename T>
+    BasicMatrix<T> mul(const BasicMatrix<T>& a, const BasicSparseMatrix<T>& b, bool transpose_a = false, bool transpose_b = false)
     {
-        assert(rows(a) > 0);
-        assert(cols(a) > 0);
-        FloatMatrix out;
-        for(int i=0; i<rows(a); i++)
-        {
-            std::vector<float> row;
-            for(int j=0; j<cols(a); j++)
-            {
-                row.push_back(a[i][j] * b);
-            }
-            out.push_back(row);
-        }
+        BasicMatrix<T> out;
+        mul(a, b, transpose_a, transpose_b, out);
         return out;
     }
 
-    FloatMatrix transpose(const FloatMatrix& a)
+    /*
+     * detects callables that also offer a vectorized f.apply(const float* in, float* out, int n),
+     * such as the activation functions in activation.hpp
+     */
+    template<typename F, typename = void>
+    struct has_batch_apply : std::false_type
     {
-        assert(rows(a) > 0);
-        assert(cols(a) > 0);
-        FloatMatrix out;
-        for(int i=0; i<cols(a); i++)
+    };
+
+    template<typename F>
+    struct has_batch_apply<F, decltype(std::declval<const F&>().apply(std::declval<const float*>(), std::declval<float*>(), 0))> : std::true_type
+    {
+    };
+
+    template<typename F>
+    void apply_function(const float* in, float* out, int n, const F& f, std::true_type)
+    {
+        f.apply(in, out, n);
+    }
+
+    /*
+     * half-width elements are widened to float in small blocks, so that they also get the vectorized version
+     */
+    template<typename T, typename F>
+    void apply_function(const T* in, T* out, int n, const F& f, std::true_type)
+    {
+        float buffer[256];
+        for(int i=0; i<n; i+=256)
         {
-            std::vector<float> row;
-            for(int j=0; j<rows(a); j++)
-            {
-                row.push_back(a[j][i]);
-            }
-            out.push_back(row);
+            auto m = std::min(256, n - i);
+            std::copy(in + i, in + i + m, buffer);
+            f.apply(buffer, buffer, m);
+            std::copy(buffer, buffer + m, out + i);
         }
-        return out;
     }
 
-    FloatMatrix mul(const FloatMatrix& a, const FloatMatrix& b)
+    template<typename T, typename F>
+    void apply_function(const T* in, T* out, int n, const F& f, std::false_type)
     {
-        assert(rows(a) > 0);
-        assert(cols(a) > 0);
-        assert(rows(b) > 0);
-        assert(cols(b) > 0);
-        assert(cols(a) == rows(b));
-        auto out = zero(rows(a), cols(b));
-        for(int i=0; i<rows(a); i++)
+        for(int i=0; i<n; i++)
         {
-            for(int j=0; j<cols(b); j++)
-            {
-                for(int k=0; k<cols(a); k++)
-                {
-                    out[i][j] += a[i][k] * b[k][j];
-                }
-            }
+            out[i] = static_cast<T>(f(static_cast<accumulator_type<T>>(in[i])));
         }
-        return out;
     }
 
-    FloatMatrix apply_function(const FloatMatrix& a, const std::function<float(float)>& f)
+    /*!
+     * apply a function to each element of a matrix
+     * f can be any callable (its call is inlined), callables with a batch apply() method are applied in vectorized form.
+     * f is called with elements in their accumulator type (float for float, bfloat16 and float16 matrices, double for double matrices).
+     * for large matrices f is called from several threads at once, so it must not modify shared state
+     * the result is written to out, whose storage is reused when it is large enough
+     */
+    template<typename T, typename F>
+    void apply_function(const BasicMatrix<T>& a, const F& f, BasicMatrix<T>& out)
     {
-        auto out = FloatMatrix();
-        for(int i=0; i<rows(a); i++)
+        typedef std::integral_constant<bool, has_batch_apply<F>::value && std::is_same<accumulator_type<T>, float>::value> batch;
+        out.resize(rows(a), cols(a));
+        auto pa = a.data();
+        auto po = out.data();
+        parallel::parallel_for(0, out.size(), 8, [pa, po, &f](int begin, int end)
         {
-            std::vector<float> row;
-            for(int j=0; j<cols(a); j++)
-            {
-                row.push_back(f(a[i][j]));
-            }
-            out.push_back(row);
-        }
+            apply_function(pa + begin, po + begin, end - begin, f, batch());
+        });
+    }
+
+    template<typename T, typename F>
+    BasicMatrix<T> apply_function(const BasicMatrix<T>& a, const F& f)
+    {
+        BasicMatrix<T> out;
+        apply_function(a, f, out);
         return out;
     }
 
-    void print_matrix(const FloatMatrix& m)
+    template<typename T>
+    void print_matrix(const BasicMatrix<T>& m)
     {
         auto M = rows(m);
         auto N = cols(m);
@@ -255,10 +1429,179 @@ namespace matrix
             std::cout << (i == 0 ? "" : " ") << "[";
             for(int j=0; j<N; j++)
             {
-                std::cout << m[i][j] << (j == N - 1 ? "]" : " ");
+                std::cout << (accumulator_type<T>) m[i][j] << (j == N - 1 ? "]" : " ");
             }
             std::cout << (i == M - 1 ? "]" : "") << std::endl;
         }
     }
-}
 
+    /*
+     * call f(std::integral_constant<int, i>()) for i in [0 .. N), unrolled at compile time
+     */
+    template<typename F, int... I>
+    void unroll(const F& f, std::integer_sequence<int, I...>)
+    {
+        (f(std::integral_constant<int, I>()), ...);
+    }
+
+    template<int N, typename F>
+    void unroll(const F& f)
+    {
+        unroll(f, std::make_integer_sequence<int, N>());
+    }
+
+    /*!
+     * A dense R x C matrix whose dimensions are known at compile time, stored inline (on the stack for local variables)
+     * in row-major order. Meant for tiny models, where the heap allocations and size checks of BasicMatrix dominate the runtime.
+     * mul and apply_function on fixed matrices are fully unrolled.
+     */
+    template<int R, int C, typename T = float>
+    class FixedMatrix
+    {
+        public:
+
+            static_assert(R > 0 && C > 0, "fixed matrices can not be empty");
+
+            typedef T value_type;
+
+            /*! a matrix filled with zeroes
+             */
+            FixedMatrix()
+            {
+                std::fill(data_, data_ + R * C, T(0.0f));
+            }
+
+            /*! build a matrix from a list of rows
+             */
+            FixedMatrix(std::initializer_list<std::initializer_list<T>> m)
+                : FixedMatrix()
+            {
+                assert(m.size() == R);
+                auto p = data_;
+                for(auto& row : m)
+                {
+                    assert(row.size() == C);
+                    p = std::copy(row.begin(), row.end(), p);
+                }
+            }
+
+            /*! copy a dynamic matrix of dimensions R x C
+             */
+            explicit FixedMatrix(const BasicMatrix<T>& m)
+            {
+                assert(m.rows() == R);
+                assert(m.cols() == C);
+                std::copy(m.data(), m.data() + R * C, data_);
+            }
+
+            static constexpr int rows()
+            {
+                return R;
+            }
+
+            static constexpr int cols()
+            {
+                return C;
+            }
+
+            static constexpr int size()
+            {
+                return R * C;
+            }
+
+            T* data()
+            {
+                return data_;
+            }
+
+            const T* data() const
+            {
+                return data_;
+            }
+
+            T& operator()(int i, int j)
+            {
+                assert(i >= 0 && i < R);
+                assert(j >= 0 && j < C);
+                return data_[i * C + j];
+            }
+
+            T operator()(int i, int j) const
+            {
+                assert(i >= 0 && i < R);
+                assert(j >= 0 && j < C);
+                return data_[i * C + j];
+            }
+
+        private:
+
+            T data_[R * C];
+    };
+
+    template<int R, int C, typename T>
+    int rows(const FixedMatrix<R, C, T>&)
+    {
+        return R;
+    }
+
+    template<int R, int C, typename T>
+    int cols(const FixedMatrix<R, C, T>&)
+    {
+        return C;
+    }
+
+    /*! return a dynamic copy of a fixed matrix
+     */
+    template<int R, int C, typename T>
+    BasicMatrix<T> dynamic(const FixedMatrix<R, C, T>& m)
+    {
+        BasicMatrix<T> out(R, C);
+        std::copy(m.data(), m.data() + R * C, out.data());
+        return out;
+    }
+
+    /*!
+     * Matrix multiplication of fixed matrices, fully unrolled (dimension mismatches are compile errors)
+     */
+    template<int M, int K, int N, typename T>
+    FixedMatrix<M, N, T> mul(const FixedMatrix<M, K, T>& a, const FixedMatrix<K, N, T>& b)
+    {
+        FixedMatrix<M, N, T> out;
+        auto pa = a.data();
+        auto pb = b.data();
+        auto po = out.data();
+        unroll<M>([=](auto i)
+        {
+            accumulator_type<T> acc[N] = {};
+            unroll<K>([&](auto k)
+            {
+                accumulator_type<T> a_ik = pa[i * K + k];
+                unroll<N>([&](auto j)
+                {
+                    acc[j] += a_ik * (accumulator_type<T>) pb[k * N + j];
+                });
+            });
+            unroll<N>([&](auto j)
+            {
+                po[i * N + j] = T(acc[j]);
+            });
+        });
+        return out;
+    }
+
+    /*!
+     * apply a function to each element of a fixed matrix, fully unrolled
+     */
+    template<int R, int C, typename T, typename F>
+    FixedMatrix<R, C, T> apply_function(const FixedMatrix<R, C, T>& a, const F& f)
+    {
+        FixedMatrix<R, C, T> out;
+        auto pa = a.data();
+        auto po = out.data();
+        unroll<R * C>([&](auto i)
+        {
+            po[i] = static_cast<T>(f(static_cast<accumulator_type<T>>(pa[i])));
+        });
+        return out;
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <assert.h>
+#include <vector>
+
+#include "matrix.hpp"
+#include "rng.hpp"
+
+namespace numeric
+{
+
+    /*!
+     * What to do with the last batch of an epoch when the number of datapoints is not a multiple of the batch size:
+     * partial : keep it, smaller than the others
+     * drop    : skip it (its datapoints are left out of that epoch)
+     * wrap    : fill it up with datapoints from the start of the epoch, so every batch has the same size
+     */
+    enum class LastBatch
+    {
+        partial,
+        drop,
+        wrap
+    };
+
+    /*!
+     * Mini-batches over n datapoints: every epoch visits the datapoints in a new random order (a shuffled permutation,
+     * drawn from rng::thread_generator(), so it follows the seed), split into batches of batch_size indices.
+     * Steps are numbered globally: step s is batch s % batches_per_epoch() of epoch s / batches_per_epoch().
+     * Steps are meant to be visited in order; a step of a later epoch reshuffles once.
+     */
+    class MiniBatches
+    {
+        public:
+
+            MiniBatches(int n, int batch_size, bool shuffle = true, LastBatch last_batch = LastBatch::partial)
+                : n_(n), batch_size_(std::min(batch_size, n)), shuffle_(shuffle), last_batch_(last_batch), epoch_(-1), permutation_(n)
+            {
+                assert(n >= 1);
+                assert(batch_size >= 1);
+                for(int i=0; i<n; i++)
+                {
+                    permutation_[i] = i;
+                }
+            }
+
+            /*! return the number of batches in an epoch
+             */
+            int batches_per_epoch() const
+            {
+                return last_batch_ == LastBatch::drop ? n_ / batch_size_ : (n_ + batch_size_ - 1) / batch_size_;
+            }
+
+            /*! return the epoch of a step
+             */
+            int epoch(int step) const
+            {
+                return step / batches_per_epoch();
+            }
+
+            /*! return the indices of the datapoints of a step (valid until the next call)
+             */
+            matrix::Span<const int> batch(int step)
+            {
+                assert(step >= 0);
+                if(epoch(step) != epoch_)
+                {
+                    epoch_ = epoch(step);
+                    if(shuffle_)
+                    {
+                        auto& generator = rng::thread_generator();
+                        for(int i=n_ - 1; i>0; i--)
+                        {
+                            std::swap(permutation_[i], permutation_[generator.uniform_int(i + 1)]);
+                        }
+                    }
+                }
+                auto start = (step % batches_per_epoch()) * batch_size_;
+                auto stop = start + batch_size_;
+                if(stop <= n_)
+                {
+                    return matrix::Span<const int>(permutation_.data() + start, batch_size_);
+                }
+                if(last_batch_ == LastBatch::partial)
+                {
+                    return matrix::Span<const int>(permutation_.data() + start, n_ - start);
+                }
+
+                // wrap: the tail of the permutation followed by its head
+                wrapped_.assign(permutation_.begin() + start, permutation_.end());
+                wrapped_.insert(wrapped_.end(), permutation_.begin(), permutation_.begin() + (stop - n_));
+                return matrix::Span<const int>(wrapped_);
+            }
+
+        private:
+
+            int n_;
+            int batch_size_;
+            bool shuffle_;
+            LastBatch last_batch_;
+            int epoch_;
+            std::vector<int> permutation_;
+            std::vector<int> wrapped_;
+    };
+
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <assert.h>
+#include <math.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "activation.hpp"
+#include "matrix.hpp"
+
+namespace numeric
+{
+
+    /*!
+     * Built-in models and losses for linear_regression. A model is a prediction function that can also predict a whole block of datapoints at once:
+     * predict(params, xs, dims, ys) writes the predictions for the rows of xs (a contiguous block, row after row, dims values each)
+     * into the preallocated ys, in a single loop over raw pointers the compiler can inline (no std::function call, no copy per row);
+     * the logistic model computes the sigmoid of a float block with the vectorized activation::Sigmoid.
+     * Like the prediction functions, models and losses are generic in the parameter type S (float, or dual numbers).
+     * Any prediction function with such a predict member is used as a batch predictor (see is_batch_predictor).
+     */
+
+    /*
+     * does Pred have a member predict(const std::vector<S>&, matrix::Span<const float>, int, matrix::Span<S>)?
+     */
+    template<typename Pred, typename S, typename = void>
+    struct is_batch_predictor : std::false_type
+    {
+    };
+
+    template<typename Pred, typename S>
+    struct is_batch_predictor<Pred, S, decltype(std::declval<const Pred&>().predict(std::declval<const std::vector<S>&>(),
+                              std::declval<matrix::Span<const float>>(), 0, std::declval<matrix::Span<S>>()), void())> : std::true_type
+    {
+    };
+
+    /*!
+     * Linear model: y = params[0] * x[0] + .. + params[dims - 1] * x[dims - 1] + params[dims] (the intercept)
+     */
+    struct LinearModel
+    {
+        template<typename S>
+        S operator()(const std::vector<S>& params, matrix::Span<const float> x) const
+        {
+            assert(params.size() == x.size() + 1);
+            auto y = params[x.size()];
+            for(int j=0; j<x.size(); j++)
+            {
+                y += x[j] * params[j];
+            }
+            return y;
+        }
+
+        template<typename S>
+        void predict(const std::vector<S>& params, matrix::Span<const float> xs, int dims, matrix::Span<S> ys) const
+        {
+            assert(params.size() == dims + 1);
+            assert(xs.size() == ys.size() * dims);
+            auto x = xs.data();
+            auto p = params.data();
+            for(int i=0; i<ys.size(); i++)
+            {
+                auto y = p[dims];
+                for(int j=0; j<dims; j++)
+                {
+                    y += x[i * dims + j] * p[j];
+                }
+                ys[i] = y;
+            }
+        }
+    };
+
+    /*!
+     * Polynomial model in a single variable: y = params[0] + params[1] * x + .. + params[n] * x^n (evaluated with Horner's rule)
+     */
+    struct PolynomialModel
+    {
+        template<typename S>
+        S operator()(const std::vector<S>& params, matrix::Span<const float> x) const
+        {
+            assert(x.size() == 1);
+            assert(params.size() >= 1);
+            auto y = params.back();
+            for(int i=params.size() - 2; i>=0; i--)
+            {
+                y = y * x[0] + params[i];
+            }
+            return y;
+        }
+
+        template<typename S>
+        void predict(const std::vector<S>& params, matrix::Span<const float> xs, int dims, matrix::Span<S> ys) const
+        {
+            assert(dims == 1);
+            assert(params.size() >= 1);
+            assert(xs.size() == ys.size());
+            auto x = xs.data();
+            auto p = params.data();
+            int n = params.size();
+            for(int i=0; i<ys.size(); i++)
+            {
+                auto y = p[n - 1];
+                for(int k=n - 2; k>=0; k--)
+                {
+                    y = y * x[i] + p[k];
+                }
+                ys[i] = y;
+            }
+        }
+    };
+
+    /*!
+     * Logistic model: the logistic function of a linear model, y = 1 / (1 + exp(-h)), with h as in LinearModel
+     */
+    struct LogisticModel
+    {
+        template<typename S>
+        S operator()(const std::vector<S>& params, matrix::Span<const float> x) const
+        {
+            auto h = LinearModel()(params, x);
+            if constexpr(std::is_same<S, float>::value)
+            {
+                return activation::Sigmoid<>()(h);
+            }
+            else
+            {
+                return 1.0f / (1.0f + exp(-h));
+            }
+        }
+
+        template<typename S>
+        void predict(const std::vector<S>& params, matrix::Span<const float> xs, int dims, matrix::Span<S> ys) const
+        {
+            LinearModel().predict(params, xs, dims, ys);
+            if constexpr(std::is_same<S, float>::value)
+            {
+                activation::Sigmoid<>().apply(ys.data(), ys.data(), ys.size());
+            }
+            else
+            {
+                for(auto& y : ys)
+                {
+                    y = 1.0f / (1.0f + exp(-y));
+                }
+            }
+        }
+    };
+
+    /*!
+     * Mean squared error of the predictions, in a single pass
+     */
+    struct MeanSquaredError
+    {
+        template<typename S>
+        S operator()(matrix::Span<const float> ys, const std::vector<S>& pred_ys) const
+        {
+            assert(ys.size() == pred_ys.size());
+            assert(ys.size() > 0);
+            S loss = (pred_ys[0] - ys[0]) * (pred_ys[0] - ys[0]);
+            for(int i=1; i<ys.size(); i++)
+            {
+                loss += (pred_ys[i] - ys[i]) * (pred_ys[i] - ys[i]);
+            }
+            return loss / (float) ys.size();
+        }
+    };
+
+    /*!
+     * Mean cross-entropy of predicted probabilities for targets of zero or one, in a single pass
+     * (predictions are clamped to [0.001 .. 0.999])
+     */
+    struct CrossEntropy
+    {
+        template<typename S>
+        S operator()(matrix::Span<const float> ys, const std::vector<S>& pred_ys) const
+        {
+            assert(ys.size() == pred_ys.size());
+            assert(ys.size() > 0);
+            auto term = [](float y, S pred_y)
+            {
+                if(pred_y < 0.001f)
+                {
+                    pred_y = 0.001f;
+                }
+                if(pred_y > 0.999f)
+                {
+                    pred_y = 0.999f;
+                }
+                return -y * log(pred_y) - (1.0f - y) * log(1.0f - pred_y);
+            };
+            S loss = term(ys[0], pred_ys[0]);
+            for(int i=1; i<ys.size(); i++)
+            {
+                loss += term(ys[i], pred_ys[i]);
+            }
+            return loss / (float) ys.size();
+        }
+    };
+
+}
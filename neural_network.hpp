@@ -4,94 +4,265 @@
 #include <functional>
 #include <iostream>
 #include <tuple>
+#include <utility>
 #include <vector>
 
+#include "activation.hpp"
 #include "matrix.hpp"
+#include "optimizer.hpp"
+#include "reductions.hpp"
+#include "rng.hpp"
+#include "schedule.hpp"
 
 namespace nn
 {
 
     /*!
-     * Initialize the weight matrices of a neural network.
+     * Weight initialization schemes
+     * uniform : weights drawn from [0 .. 1)
+     * xavier  : Xavier (Glorot) uniform initialization, suited for sigmoid and tanh layers
+     * he      : He (Kaiming) normal initialization, suited for rectifier layers
      */
-    std::vector<matrix::FloatMatrix> init_neural_network(std::vector<int> layer_sizes)
+    enum class Initializer
+    {
+        uniform,
+        xavier,
+        he
+    };
+
+    /*
+     * puts T in a non-deduced context, so that inputs given as nested vectors convert to BasicMatrix<T>
+     * while T is deduced from the weights alone
+     */
+    template<typename T>
+    struct identity
+    {
+        typedef T type;
+    };
+
+    template<typename T>
+    using Input = typename identity<matrix::BasicMatrix<T>>::type;
+
+    /*!
+     * Initialize the weight matrices of a neural network, with elements of type T
+     * (float by default; double, or bfloat16 / float16 to halve the memory taken by large layers).
+     * Weights are drawn from the given generator (by default: the generator of the calling thread, see rng::set_seed),
+     * so every layer gets its own weights and a fixed seed reproduces the same network.
+     */
+    template<typename T = float>
+    std::vector<matrix::BasicMatrix<T>> init_neural_network(
+        std::vector<int> layer_sizes,
+        Initializer initializer = Initializer::uniform,
+        rng::Generator& generator = rng::thread_generator()
+    )
     {
         assert(layer_sizes.size() >= 2);
-        std::vector<matrix::FloatMatrix> mtx;
+        std::vector<matrix::BasicMatrix<T>> mtx;
         for(int i=0; i<layer_sizes.size() - 1; i++)
         {
             auto m = layer_sizes[i];
             auto n = layer_sizes[i+1];
-            mtx.push_back(matrix::random(m, n));
+            switch(initializer)
+            {
+                case Initializer::xavier:
+                    mtx.push_back(matrix::xavier<T>(m, n, generator));
+                    break;
+                case Initializer::he:
+                    mtx.push_back(matrix::he<T>(m, n, generator));
+                    break;
+                default:
+                    mtx.push_back(matrix::random<T>(m, n, generator));
+                    break;
+            }
         }
         return mtx;
     }
 
     /*!
-     * Feed an input matrix to a neural network with specified weights
+     * Buffers for the intermediate matrices of a training step: activations, transfers, deltas and weight updates.
+     * A workspace is the arena that backpropagation takes its temporaries from. The first step sizes the buffers,
+     * every later step of the same shape reuses them, so the steady-state training loop does not allocate.
+     * release() frees all buffers at once.
      */
-    std::tuple<std::vector<matrix::FloatMatrix>, std::vector<matrix::FloatMatrix>> feedforward(const matrix::FloatMatrix& xs, const std::vector<matrix::FloatMatrix>& weights)
+    template<typename T = float>
+    struct Workspace
     {
+        std::vector<matrix::BasicMatrix<T>> as;
+        std::vector<matrix::BasicMatrix<T>> bs;
+        std::vector<matrix::BasicMatrix<T>> deltas;
+        std::vector<matrix::BasicMatrix<T>> weight_updates;
+        matrix::BasicMatrix<T> xs;
+        matrix::BasicMatrix<T> ys;
 
-        std::vector<matrix::FloatMatrix> as;
-        std::vector<matrix::FloatMatrix> bs;
-
-        // define activation function
-        auto activation_function = [](float x)
+        void release()
         {
-            return 1.0f / (1.0f + exp(-x));
-        };
+            std::vector<matrix::BasicMatrix<T>>().swap(as);
+            std::vector<matrix::BasicMatrix<T>>().swap(bs);
+            std::vector<matrix::BasicMatrix<T>>().swap(deltas);
+            std::vector<matrix::BasicMatrix<T>>().swap(weight_updates);
+            xs = matrix::BasicMatrix<T>();
+            ys = matrix::BasicMatrix<T>();
+        }
+    };
 
-        // initialize as
-        as.push_back(xs);
+    /*
+     * run a batch of inputs (dense or sparse) through all layers, filling workspace.as[1 ..] and workspace.bs
+     */
+    template<typename T, typename X>
+    void feedforward_layers(const X& xs, const std::vector<matrix::BasicMatrix<T>>& weights, Workspace<T>& workspace)
+    {
+        auto& as = workspace.as;
+        auto& bs = workspace.bs;
+
+        // define activation function (vectorized logistic function, exact for double)
+        auto activation_function = activation::Sigmoid<>();
 
         // run the input through all layers
         for(int i = 0 ; i < weights.size() ; i++)
         {
             // matrix multiplication
-            bs.push_back(matrix::mul(as[as.size() - 1], weights[i]));
+            if(i == 0)
+            {
+                matrix::mul(xs, weights[0], false, false, bs[0]);
+            }
+            else
+            {
+                matrix::mul(as[i], weights[i], false, false, bs[i]);
+            }
 
             // logistic function
-            as.push_back(matrix::apply_function(bs[bs.size()-1], activation_function));
+            matrix::apply_function(bs[i], activation_function, as[i + 1]);
         }
+    }
+
+    /*!
+     * Feed an input matrix to a neural network with specified weights,
+     * leaving the activations and transfers of every layer in workspace.as and workspace.bs
+     */
+    template<typename T>
+    void feedforward(const matrix::BasicMatrix<T>& xs, const std::vector<matrix::BasicMatrix<T>>& weights, Workspace<T>& workspace)
+    {
+        workspace.as.resize(weights.size() + 1);
+        workspace.bs.resize(weights.size());
+        workspace.as[0] = xs;
+        feedforward_layers(xs, weights, workspace);
+    }
+
+    /*!
+     * Feed a sparse batch of inputs (e.g. one-hot or hashed features) to a neural network with specified weights.
+     * The first layer costs O(non-zeros) instead of O(rows * cols). The input is not copied, so workspace.as[0] is left empty.
+     */
+    template<typename T>
+    void feedforward(const matrix::BasicSparseMatrix<T>& xs, const std::vector<matrix::BasicMatrix<T>>& weights, Workspace<T>& workspace)
+    {
+        workspace.as.resize(weights.size() + 1);
+        workspace.bs.resize(weights.size());
+        workspace.as[0].resize(0, 0);
+        feedforward_layers(xs, weights, workspace);
+    }
+
+    /*!
+     * Feed an input matrix to a neural network with specified weights
+     */
+    template<typename T>
+    std::tuple<std::vector<matrix::BasicMatrix<T>>, std::vector<matrix::BasicMatrix<T>>> feedforward(const Input<T>& xs, const std::vector<matrix::BasicMatrix<T>>& weights)
+    {
+        Workspace<T> workspace;
+        feedforward(xs, weights, workspace);
+        return std::make_tuple(std::move(workspace.as), std::move(workspace.bs));
+    }
 
-        // output
-        return std::make_tuple(as, bs);
+    /*!
+     * Feed a sparse batch of inputs to a neural network with specified weights (as[0] is left empty)
+     */
+    template<typename T>
+    std::tuple<std::vector<matrix::BasicMatrix<T>>, std::vector<matrix::BasicMatrix<T>>> feedforward(const matrix::BasicSparseMatrix<T>& xs, const std::vector<matrix::BasicMatrix<T>>& weights)
+    {
+        Workspace<T> workspace;
+        feedforward(xs, weights, workspace);
+        return std::make_tuple(std::move(workspace.as), std::move(workspace.bs));
     }
 
     /*!
      * Feed an input vector (single row) to a neural network with specified weights
      */
-    std::tuple<std::vector<matrix::FloatMatrix>, std::vector<matrix::FloatMatrix>> feedforward(const std::vector<float>& xs, const std::vector<matrix::FloatMatrix>& weights)
+    template<typename T>
+    std::tuple<std::vector<matrix::BasicMatrix<T>>, std::vector<matrix::BasicMatrix<T>>> feedforward(const std::vector<float>& xs, const std::vector<matrix::BasicMatrix<T>>& weights)
     {
-        auto mtx = matrix::FloatMatrix();
-        mtx.push_back(xs);
-        return feedforward(mtx, weights);
+        matrix::BasicMatrix<T> mtx = std::vector<std::vector<float>>{xs};
+        return feedforward<T>(mtx, weights);
     }
 
     /*! The Loss Function is one of the important components of Neural Networks.
      * Loss is nothing but a prediction error of Neural Net.
      * And the method to calculate the loss is called Loss Function.
      */
-    matrix::FloatMatrix loss(const matrix::FloatMatrix& xs, const matrix::FloatMatrix& ys, const std::vector<matrix::FloatMatrix>& weights)
+    template<typename T>
+    matrix::BasicMatrix<T> loss(const Input<T>& xs, const Input<T>& ys, const std::vector<matrix::BasicMatrix<T>>& weights)
     {
 
         // forward pass
-        auto as = std::get<0>(feedforward(xs, weights));
+        auto as = std::get<0>(feedforward<T>(xs, weights));
+
+        // mean squared error of every output
+        matrix::BasicMatrix<T> loss_mtx = (1.0 / matrix::rows(xs)) * matrix::squared_norm(ys - as[as.size()-1], matrix::Direction::colwise);
+        return loss_mtx;
+    }
+
+    /*
+     * one training step on a batch of inputs (dense or sparse), see backpropagation below
+     */
+    template<typename T, typename X>
+    void backpropagation_layers(
+        const X& xs,
+        const matrix::BasicMatrix<T>& ys_mtx,
+        std::vector<matrix::BasicMatrix<T>>& weights,
+        optim::Optimizer<T>& optimizer,
+        float learning_rate,
+        Workspace<T>& workspace
+    )
+    {
+
+        // activations and transfers
+        feedforward(xs, weights, workspace);
+        auto& as = workspace.as;
 
-        // predicted ys
-        auto ys_pred = as[as.size()-1];
+        // derivative of the activation function, expressed in terms of the activation itself
+        auto activation_function_derivative = [](auto x)
+        {
+            return x * (1 - x);
+        };
+
+        // delta(s) (derivatives of the loss), fused with the activation function derivative(s)
+        // the input layer does not need a delta, so deltas[0] is left empty
+        int L = as.size() - 1;
+        auto& deltas = workspace.deltas;
+        deltas.resize(as.size());
+        deltas[L] = (as[L] - ys_mtx) % matrix::map(as[L], activation_function_derivative);
+        for(int i=L - 1 ; i >= 1 ; i--)
+        {
+            matrix::mul(deltas[i + 1], weights[i], false, true, deltas[i]);
+            deltas[i] = deltas[i] % matrix::map(as[i], activation_function_derivative);
+        }
 
-        // aggregate loss
-        auto loss_mtx = matrix::zero(1, matrix::cols(ys));
-        for(int i=0; i<matrix::rows(ys); i++)
+        // gradient(s) of the weight(s), in a single pass per layer (transposes are folded into the multiplication)
+        // the first layer reads the inputs themselves, which for sparse inputs only visits their non-zeros
+        // the optimizer then updates every layer, keeping its state (if any) in the slot of the layer
+        auto& weight_updates = workspace.weight_updates;
+        weight_updates.resize(weights.size());
+        for(int i = 1 ; i < deltas.size() ; i++ )
         {
-            for(int j=0; j<matrix::cols(ys); j++)
+            if(i == 1)
+            {
+                matrix::mul(xs, deltas[1], true, false, weight_updates[0]);
+            }
+            else
             {
-                loss_mtx[0][j] += pow(ys[i][j] - ys_pred[i][j], 2.0f);
+                matrix::mul(as[i-1], deltas[i], true, false, weight_updates[i - 1]);
             }
+            optimizer.update(i - 1, weights[i - 1], weight_updates[i - 1], learning_rate);
         }
-        return matrix::scalar(loss_mtx, 1.0f / xs.size());
+
     }
 
     /*!
@@ -100,91 +271,252 @@ namespace nn
      * unlike a naive direct computation of the gradient with respect to each weight individually.
      * This efficiency makes it feasible to use gradient methods for training multilayer networks,
      * updating weights to minimize loss; gradient descent, or variants such as stochastic gradient descent, are commonly used.
+     * This version updates the weights in place with the given optimizer (e.g. optim::Adam, see optimizer.hpp),
+     * and takes all its temporaries from the workspace.
+     */
+    template<typename T>
+    void backpropagation(
+        const matrix::BasicMatrix<T>& xs,
+        const matrix::BasicMatrix<T>& ys_mtx,
+        std::vector<matrix::BasicMatrix<T>>& weights,
+        optim::Optimizer<T>& optimizer,
+        float learning_rate,
+        Workspace<T>& workspace
+    )
+    {
+        backpropagation_layers(xs, ys_mtx, weights, optimizer, learning_rate, workspace);
+    }
+
+    /*!
+     * Backpropagation (see above) for a sparse batch of inputs: the first layer's product and weight update
+     * only visit the non-zeros of xs, so their cost scales with the number of non-zeros.
+     */
+    template<typename T>
+    void backpropagation(
+        const matrix::BasicSparseMatrix<T>& xs,
+        const matrix::BasicMatrix<T>& ys_mtx,
+        std::vector<matrix::BasicMatrix<T>>& weights,
+        optim::Optimizer<T>& optimizer,
+        float learning_rate,
+        Workspace<T>& workspace
+    )
+    {
+        backpropagation_layers(xs, ys_mtx, weights, optimizer, learning_rate, workspace);
+    }
+
+    /*!
+     * Backpropagation (see above), updating the weights in place with stochastic gradient descent.
+     */
+    template<typename T>
+    void backpropagation(
+        const matrix::BasicMatrix<T>& xs,
+        const matrix::BasicMatrix<T>& ys_mtx,
+        std::vector<matrix::BasicMatrix<T>>& weights,
+        float learning_rate,
+        Workspace<T>& workspace
+    )
+    {
+        optim::SGD<T> sgd;
+        backpropagation_layers(xs, ys_mtx, weights, sgd, learning_rate, workspace);
+    }
+
+    /*!
+     * Backpropagation (see above) for a sparse batch of inputs, updating the weights in place with stochastic gradient descent.
      */
-    std::vector<matrix::FloatMatrix> backpropagation(
+    template<typename T>
+    void backpropagation(
+        const matrix::BasicSparseMatrix<T>& xs,
+        const matrix::BasicMatrix<T>& ys_mtx,
+        std::vector<matrix::BasicMatrix<T>>& weights,
+        float learning_rate,
+        Workspace<T>& workspace
+    )
+    {
+        optim::SGD<T> sgd;
+        backpropagation_layers(xs, ys_mtx, weights, sgd, learning_rate, workspace);
+    }
+
+    /*!
+     * Backpropagation (see above), returning the updated weights
+     */
+    template<typename T>
+    std::vector<matrix::BasicMatrix<T>> backpropagation(
+        const Input<T>& xs,
+        const Input<T>& ys_mtx,
+        const std::vector<matrix::BasicMatrix<T>>& weights,
+        float learning_rate = 0.1f
+    )
+    {
+        Workspace<T> workspace;
+        auto weights_out = weights;
+        backpropagation(xs, ys_mtx, weights_out, learning_rate, workspace);
+        return weights_out;
+    }
+
+    /*!
+     * Backpropagation for a single input–output example, given as vectors.
+     */
+    template<typename T>
+    std::vector<matrix::BasicMatrix<T>> backpropagation(
         const std::vector<float>& xs,
         const std::vector<float>& ys,
-        const std::vector<matrix::FloatMatrix>& weights,
+        const std::vector<matrix::BasicMatrix<T>>& weights,
         float learning_rate = 0.1f
     )
     {
+        matrix::BasicMatrix<T> xs_mtx = std::vector<std::vector<float>>{xs};
+        matrix::BasicMatrix<T> ys_mtx = std::vector<std::vector<float>>{ys};
+        return backpropagation<T>(xs_mtx, ys_mtx, weights, learning_rate);
+    }
 
-        // derivative of transfer function
-        auto activation_derivative_function = [](float x)
+    /*!
+     * Train a network with stochastic gradient descent over the examples (rows) of xs and ys:
+     * every iteration (epoch) visits all examples once, with the learning rate the schedule gives for that epoch.
+     * The weights are updated by the given optimizer, whose state carries over from one epoch to the next.
+     * After every epoch the schedule observes the training loss of that epoch (the squared error of every example
+     * before its update, averaged over the examples), e.g. for optim::ReduceOnPlateau.
+     */
+    template<typename T>
+    std::vector<matrix::BasicMatrix<T>> train(
+        const Input<T>& xs,
+        const Input<T>& ys,
+        const std::vector<matrix::BasicMatrix<T>>& initial_weights,
+        optim::Schedule& learning_rate_schedule,
+        optim::Optimizer<T>& optimizer,
+        int max_number_of_iterations = 16384
+    )
+    {
+        // all temporaries of the training loop live in this workspace
+        Workspace<T> workspace;
+        auto w = initial_weights;
+        for(int i=0; i<max_number_of_iterations; i++)
         {
-            return x * (1.0f - x);
-        };
+            auto learning_rate = learning_rate_schedule(i);
+            double epoch_loss = 0.0;
+            for(int j=0; j<matrix::rows(xs); j++)
+            {
+                matrix::slice_rows(xs, j, j + 1, workspace.xs);
+                matrix::slice_rows(ys, j, j + 1, workspace.ys);
+                backpropagation(workspace.xs, workspace.ys, w, optimizer, learning_rate, workspace);
+                epoch_loss += matrix::squared_norm(workspace.ys - workspace.as.back());
+            }
+            learning_rate_schedule.observe(epoch_loss / matrix::rows(xs));
+        }
+        return w;
+    }
 
-        // convert ys to mtx
-        auto ys_mtx = {ys};
+    /*!
+     * Train a network (see above) with a learning rate schedule that is a function of the epoch nr.
+     */
+    template<typename T>
+    std::vector<matrix::BasicMatrix<T>> train(
+        const Input<T>& xs,
+        const Input<T>& ys,
+        const std::vector<matrix::BasicMatrix<T>>& initial_weights,
+        const std::function<float(int)>& learning_rate_schedule,
+        optim::Optimizer<T>& optimizer,
+        int max_number_of_iterations = 16384
+    )
+    {
+        optim::FunctionSchedule schedule(learning_rate_schedule);
+        return train(xs, ys, initial_weights, schedule, optimizer, max_number_of_iterations);
+    }
 
-        // activations and transfers
-        auto tpl = feedforward(xs, weights);
-        auto as = std::get<0>(tpl);
-        auto bs = std::get<1>(tpl);
+    /*!
+     * Train a network (see above) with plain stochastic gradient descent.
+     */
+    template<typename T>
+    std::vector<matrix::BasicMatrix<T>> train(
+        const Input<T>& xs,
+        const Input<T>& ys,
+        const std::vector<matrix::BasicMatrix<T>>& initial_weights,
+        const std::function<float(int)>& learning_rate_schedule,
+        int max_number_of_iterations = 16384
+    )
+    {
+        optim::SGD<T> sgd;
+        return train(xs, ys, initial_weights, learning_rate_schedule, sgd, max_number_of_iterations);
+    }
 
-        // activation function derivative(s)
-        auto activation_function_derivative = [](float x)
-        {
-            return x * (1.0f - x);
-        };
-        auto as_derivatives = std::vector<matrix::FloatMatrix>();
-        for(int i=0; i<as.size(); i++)
+    /*
+     * the layers of a network with a compile-time topology: layer I -> O, followed by the remaining layers
+     */
+    template<typename T, int I, int O, int... Rest>
+    struct FixedLayers
+    {
+        matrix::FixedMatrix<I, O, T> weights;
+        FixedLayers<T, O, Rest...> next;
+
+        void load(const std::vector<matrix::BasicMatrix<T>>& w, int layer)
         {
-            as_derivatives.push_back(matrix::apply_function(as[i], activation_function_derivative));
+            weights = matrix::FixedMatrix<I, O, T>(w[layer]);
+            next.load(w, layer + 1);
         }
 
-        // delta(s)
-        auto deltas = std::vector<matrix::FloatMatrix>();
-        for(int i=as.size() - 1 ; i >= 0 ; i--)
+        template<int B>
+        auto feedforward(const matrix::FixedMatrix<B, I, T>& xs) const
         {
-            auto delta = matrix::FloatMatrix();
-            if(i == as.size() - 1)
-            {
-                delta = matrix::dotproduct(matrix::subtract(ys_mtx, as[i]), as_derivatives[i]);
-            }
-            else
-            {
-                delta = matrix::dotproduct(matrix::mul(deltas[0], matrix::transpose(weights[i])), as_derivatives[i]);
-            }
-            // insert
-            deltas.insert(deltas.begin(), delta);
+            return next.feedforward(matrix::apply_function(matrix::mul(xs, weights), activation::Sigmoid<>()));
         }
+    };
 
-        // update weight(s)
-        auto weights_out = std::vector<matrix::FloatMatrix>();
-        for(int i = 1 ; i < deltas.size() ; i++ )
+    template<typename T, int I, int O>
+    struct FixedLayers<T, I, O>
+    {
+        matrix::FixedMatrix<I, O, T> weights;
+
+        void load(const std::vector<matrix::BasicMatrix<T>>& w, int layer)
         {
-            auto weight_update = matrix::scalar(matrix::mul(matrix::transpose(as[i-1]), deltas[i]), learning_rate);
-            weights_out.push_back(matrix::add(weights[i - 1], weight_update));
+            weights = matrix::FixedMatrix<I, O, T>(w[layer]);
         }
 
-        // return
-        return weights_out;
-
-    }
+        template<int B>
+        matrix::FixedMatrix<B, O, T> feedforward(const matrix::FixedMatrix<B, I, T>& xs) const
+        {
+            return matrix::apply_function(matrix::mul(xs, weights), activation::Sigmoid<>());
+        }
+    };
 
     /*!
+     * A neural network whose topology is fixed at compile time, e.g. FixedNetwork<2, 3, 3, 1>, for low-latency inference.
+     * All weights are stored inline and every layer is a fully unrolled fixed-size product, so feedforward does not allocate.
+     * Weights are copied from a network trained with the dynamic functions above (which must have the same topology).
      */
-    std::vector<matrix::FloatMatrix> train(
-        const matrix::FloatMatrix& xs,
-        const matrix::FloatMatrix& ys,
-        const std::vector<matrix::FloatMatrix>& initial_weights,
-        const std::function<float(int)>& learning_rate_schedule,
-        int max_number_of_iterations = 16384
-    )
+    template<typename T, int... Sizes>
+    class BasicFixedNetwork
     {
-        auto learning_rate = learning_rate_schedule(0);
-        auto w = backpropagation(xs[0], ys[0], initial_weights, learning_rate);
-        for(int i=0; i<max_number_of_iterations; i++)
-        {
-            for(int j=0; j<xs.size(); j++)
+        public:
+
+            static_assert(sizeof...(Sizes) >= 2, "a network needs at least an input and an output layer");
+
+            static constexpr int number_of_layers = sizeof...(Sizes);
+            static constexpr int inputs = std::get<0>(std::make_tuple(Sizes...));
+            static constexpr int outputs = std::get<sizeof...(Sizes) - 1>(std::make_tuple(Sizes...));
+
+            BasicFixedNetwork()
             {
-                w = backpropagation(xs[j], ys[j], w, 1.0f);
             }
-            learning_rate = learning_rate_schedule(i);
-        }
-        return w;
-    }
+
+            explicit BasicFixedNetwork(const std::vector<matrix::BasicMatrix<T>>& weights)
+            {
+                assert(weights.size() == number_of_layers - 1);
+                layers_.load(weights, 0);
+            }
+
+            /*! feed a batch of B inputs to the network, return the activations of the output layer
+             */
+            template<int B>
+            matrix::FixedMatrix<B, outputs, T> feedforward(const matrix::FixedMatrix<B, inputs, T>& xs) const
+            {
+                return layers_.feedforward(xs);
+            }
+
+        private:
+
+            FixedLayers<T, Sizes...> layers_;
+    };
+
+    template<int... Sizes>
+    using FixedNetwork = BasicFixedNetwork<float, Sizes...>;
 
 }
@@ -0,0 +1,362 @@
+#pragma once
+
+#include <assert.h>
+#include <math.h>
+#include <type_traits>
+#include <vector>
+
+#include "half.hpp"
+#include "matrix.hpp"
+
+namespace optim
+{
+
+    /*
+     * per-slot buffers of optimizer state, sized on first use
+     */
+    template<typename A>
+    class SlotState
+    {
+        public:
+
+            A* get(int slot, int n)
+            {
+                assert(slot >= 0);
+                if(slot >= buffers_.size())
+                {
+                    buffers_.resize(slot + 1);
+                }
+                if(buffers_[slot].size() != n)
+                {
+                    buffers_[slot].assign(n, A(0));
+                }
+                return buffers_[slot].data();
+            }
+
+            void clear()
+            {
+                buffers_.clear();
+            }
+
+        private:
+
+            std::vector<std::vector<A>> buffers_;
+    };
+
+    /*!
+     * An optimizer turns gradients into parameter updates. Parameters are updated in blocks (a vector of parameters,
+     * or the weight matrix of a layer), identified by a slot number: stateful optimizers keep their state per slot.
+     * State is allocated the first time a slot is updated, so a steady-state training loop does not allocate.
+     * Parameters of type T are updated in their accumulator type (float for half-width types). Storing a half-width parameter
+     * rounds away steps below half its spacing, so the rounding error is kept (in T, per slot) and added to the next step
+     * of the parameter (compensated summation): small steps still add up, like they do for float parameters.
+     */
+    template<typename T = float>
+    class Optimizer
+    {
+        public:
+
+            virtual ~Optimizer()
+            {
+            }
+
+            /*!
+             * update params[0 .. n) in place, descending along gradient[0 .. n) (the gradient of the loss)
+             * with the given learning rate
+             */
+            virtual void step(int slot, T* params, const T* gradient, int n, float learning_rate) = 0;
+
+            /*! forget all state, e.g. to start optimizing a new problem
+             */
+            virtual void reset()
+            {
+                rounding_errors_.clear();
+            }
+
+            void update(int slot, std::vector<T>& params, const std::vector<T>& gradient, float learning_rate)
+            {
+                assert(params.size() == gradient.size());
+                step(slot, params.data(), gradient.data(), params.size(), learning_rate);
+            }
+
+            void update(int slot, matrix::BasicMatrix<T>& params, const matrix::BasicMatrix<T>& gradient, float learning_rate)
+            {
+                assert(params.rows() == gradient.rows() && params.cols() == gradient.cols());
+                step(slot, params.data(), gradient.data(), params.size(), learning_rate);
+            }
+
+        protected:
+
+            typedef matrix::accumulator_type<T> A;
+
+            /*! return the rounding errors of the parameters of a slot (nullptr when T is its own accumulator type)
+             */
+            T* rounding_errors(int slot, int n)
+            {
+                if constexpr(std::is_same<A, T>::value)
+                {
+                    return nullptr;
+                }
+                else
+                {
+                    return rounding_errors_.get(slot, n);
+                }
+            }
+
+            /*! params[i] -= delta, carrying the rounding error of storing the result in T over to the next step
+             */
+            static void descend(T* params, T* errors, int i, A delta)
+            {
+                if constexpr(std::is_same<A, T>::value)
+                {
+                    params[i] = params[i] - delta;
+                }
+                else
+                {
+                    A target = A(params[i]) - delta + A(errors[i]);
+                    params[i] = target;
+                    errors[i] = target - A(params[i]);
+                }
+            }
+
+        private:
+
+            SlotState<T> rounding_errors_;
+    };
+
+    /*!
+     * Stochastic gradient descent: params -= learning_rate * gradient
+     */
+    template<typename T = float>
+    class SGD : public Optimizer<T>
+    {
+        public:
+
+            void step(int slot, T* params, const T* gradient, int n, float learning_rate) override
+            {
+                auto e = this->rounding_errors(slot, n);
+                for(int i=0; i<n; i++)
+                {
+                    this->descend(params, e, i, learning_rate * A(gradient[i]));
+                }
+            }
+
+        private:
+
+            typedef matrix::accumulator_type<T> A;
+    };
+
+    /*!
+     * Momentum: a velocity accumulates past gradients (v = momentum * v + gradient) and params -= learning_rate * v,
+     * which speeds up progress along directions of consistent descent and damps oscillations.
+     */
+    template<typename T = float>
+    class Momentum : public Optimizer<T>
+    {
+        public:
+
+            Momentum(float momentum = 0.9f)
+                : momentum_(momentum)
+            {
+                assert(momentum >= 0.0f && momentum < 1.0f);
+            }
+
+            void step(int slot, T* params, const T* gradient, int n, float learning_rate) override
+            {
+                auto e = this->rounding_errors(slot, n);
+                auto v = velocity_.get(slot, n);
+                for(int i=0; i<n; i++)
+                {
+                    v[i] = momentum_ * v[i] + A(gradient[i]);
+                    this->descend(params, e, i, learning_rate * v[i]);
+                }
+            }
+
+            void reset() override
+            {
+                Optimizer<T>::reset();
+                velocity_.clear();
+            }
+
+        private:
+
+            typedef matrix::accumulator_type<T> A;
+            float momentum_;
+            SlotState<A> velocity_;
+    };
+
+    /*!
+     * Nesterov accelerated gradient: momentum, with the step taken from the look-ahead point
+     * (params -= learning_rate * (gradient + momentum * v)).
+     */
+    template<typename T = float>
+    class Nesterov : public Optimizer<T>
+    {
+        public:
+
+            Nesterov(float momentum = 0.9f)
+                : momentum_(momentum)
+            {
+                assert(momentum >= 0.0f && momentum < 1.0f);
+            }
+
+            void step(int slot, T* params, const T* gradient, int n, float learning_rate) override
+            {
+                auto e = this->rounding_errors(slot, n);
+                auto v = velocity_.get(slot, n);
+                for(int i=0; i<n; i++)
+                {
+                    A g = gradient[i];
+                    v[i] = momentum_ * v[i] + g;
+                    this->descend(params, e, i, learning_rate * (g + momentum_ * v[i]));
+                }
+            }
+
+            void reset() override
+            {
+                Optimizer<T>::reset();
+                velocity_.clear();
+            }
+
+        private:
+
+            typedef matrix::accumulator_type<T> A;
+            float momentum_;
+            SlotState<A> velocity_;
+    };
+
+    /*!
+     * RMSProp: every parameter's step is divided by a moving average of its squared gradients,
+     * so parameters with large gradients take smaller steps.
+     */
+    template<typename T = float>
+    class RMSProp : public Optimizer<T>
+    {
+        public:
+
+            RMSProp(float decay = 0.9f, float epsilon = 1e-8f)
+                : decay_(decay), epsilon_(epsilon)
+            {
+                assert(decay >= 0.0f && decay < 1.0f);
+            }
+
+            void step(int slot, T* params, const T* gradient, int n, float learning_rate) override
+            {
+                auto e = this->rounding_errors(slot, n);
+                auto s = squares_.get(slot, n);
+                for(int i=0; i<n; i++)
+                {
+                    A g = gradient[i];
+                    s[i] = decay_ * s[i] + (1.0f - decay_) * g * g;
+                    this->descend(params, e, i, learning_rate * g / (sqrt(s[i]) + epsilon_));
+                }
+            }
+
+            void reset() override
+            {
+                Optimizer<T>::reset();
+                squares_.clear();
+            }
+
+        private:
+
+            typedef matrix::accumulator_type<T> A;
+            float decay_;
+            float epsilon_;
+            SlotState<A> squares_;
+    };
+
+    /*!
+     * AdaGrad: every parameter's step is divided by the root of the sum of all its squared gradients so far,
+     * so frequently updated parameters slow down while rarely updated ones keep large steps.
+     */
+    template<typename T = float>
+    class AdaGrad : public Optimizer<T>
+    {
+        public:
+
+            AdaGrad(float epsilon = 1e-8f)
+                : epsilon_(epsilon)
+            {
+            }
+
+            void step(int slot, T* params, const T* gradient, int n, float learning_rate) override
+            {
+                auto e = this->rounding_errors(slot, n);
+                auto s = squares_.get(slot, n);
+                for(int i=0; i<n; i++)
+                {
+                    A g = gradient[i];
+                    s[i] += g * g;
+                    this->descend(params, e, i, learning_rate * g / (sqrt(s[i]) + epsilon_));
+                }
+            }
+
+            void reset() override
+            {
+                Optimizer<T>::reset();
+                squares_.clear();
+            }
+
+        private:
+
+            typedef matrix::accumulator_type<T> A;
+            float epsilon_;
+            SlotState<A> squares_;
+    };
+
+    /*!
+     * Adam: moving averages of the gradients (first moment) and of the squared gradients (second moment),
+     * corrected for their bias towards zero in the first steps; the step is the first moment divided by the root of the second.
+     * Steps are counted per slot.
+     */
+    template<typename T = float>
+    class Adam : public Optimizer<T>
+    {
+        public:
+
+            Adam(float beta_1 = 0.9f, float beta_2 = 0.999f, float epsilon = 1e-8f)
+                : beta_1_(beta_1), beta_2_(beta_2), epsilon_(epsilon)
+            {
+                assert(beta_1 >= 0.0f && beta_1 < 1.0f);
+                assert(beta_2 >= 0.0f && beta_2 < 1.0f);
+            }
+
+            void step(int slot, T* params, const T* gradient, int n, float learning_rate) override
+            {
+                auto e = this->rounding_errors(slot, n);
+                auto m = first_moments_.get(slot, n);
+                auto v = second_moments_.get(slot, n);
+                auto& t = *steps_.get(slot, 1);
+                t++;
+                auto correction_1 = 1.0f / (1.0f - pow(beta_1_, t));
+                auto correction_2 = 1.0f / (1.0f - pow(beta_2_, t));
+                for(int i=0; i<n; i++)
+                {
+                    A g = gradient[i];
+                    m[i] = beta_1_ * m[i] + (1.0f - beta_1_) * g;
+                    v[i] = beta_2_ * v[i] + (1.0f - beta_2_) * g * g;
+                    this->descend(params, e, i, learning_rate * (m[i] * correction_1) / (sqrt(v[i] * correction_2) + epsilon_));
+                }
+            }
+
+            void reset() override
+            {
+                Optimizer<T>::reset();
+                first_moments_.clear();
+                second_moments_.clear();
+                steps_.clear();
+            }
+
+        private:
+
+            typedef matrix::accumulator_type<T> A;
+            float beta_1_;
+            float beta_2_;
+            float epsilon_;
+            SlotState<A> first_moments_;
+            SlotState<A> second_moments_;
+            SlotState<int> steps_;
+    };
+
+}
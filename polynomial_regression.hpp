@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "linear_regression.hpp"
+#include "models.hpp"
 
 namespace numeric
 {
@@ -13,11 +14,14 @@ namespace numeric
      * Polynomial Regression is a form of linear regression in which
      * the relationship between the independent variable x and dependent variable y
      * is modeled as an nth degree polynomial.
+     * The coefficients minimize the mean squared error (plus ridge times their squared norm, to shrink them).
      */
     std::vector<float> polynomial_regression(
-        const std::vector<float>& xs, 	//! xs datapoints
-        const std::vector<float>& ys, 	//! ys datapoints
-        int degree_of_polynomial	//! maximum degree of the polynomial to fit
+        const std::vector<float>& xs, 						//! xs datapoints
+        const std::vector<float>& ys, 						//! ys datapoints
+        int degree_of_polynomial,						//! maximum degree of the polynomial to fit
+        LeastSquaresMethod method = LeastSquaresMethod::qr,			//! factorization of the least squares solve
+        float ridge = 0.0f							//! ridge regularization strength
     )
     {
 
@@ -27,34 +31,6 @@ namespace numeric
         assert(xs.size() == ys.size());
 
 
-        // build loss function
-        auto mae_loss_function = [](std::vector<float> pred_ys, std::vector<float> ys)
-        {
-            assert(pred_ys.size() == ys.size());
-            auto k = 0.0;
-            for(int i=0; i<pred_ys.size(); i++)
-            {
-                auto j = abs(pred_ys[i] - ys[i]);
-                k += j;
-            }
-            k /= pred_ys.size();
-            return k;
-        };
-
-        // build pred function
-        auto poly_pred_function = [](std::vector<float> coeffs, std::vector<float> xs)
-        {
-            assert(xs.size() == 1);
-            assert(coeffs.size() >= 1);
-            auto x = xs[0];
-            auto y = 0.0;
-            for(int i=0; i<coeffs.size(); i++)
-            {
-                y += pow(x, i) * coeffs[i];
-            }
-            return y;
-        };
-
         // build initial params
         std::vector<float> coeffs;
         for(int i=0; i<=degree_of_polynomial; i++)
@@ -69,12 +45,21 @@ namespace numeric
             mtx_xs.push_back({xs[i]});
         }
 
-        // delegate
+        // delegate (the polynomial is linear in its coefficients, so they are found with a single least squares solve)
         return linear_regression(mtx_xs,
                                  ys,
-                                 poly_pred_function,
+                                 PolynomialModel(),
                                  coeffs,
-                                 mae_loss_function);
+                                 MeanSquaredError(),
+                                 step_decay_learning_rate(1.0f, 0.5f, 1024),
+                                 16384,
+                                 -1,
+                                 Solver::least_squares,
+                                 LastBatch::partial,
+                                 256,
+                                 false,
+                                 method,
+                                 ridge);
     }
 
 }
@@ -0,0 +1,702 @@
+#pragma once
+
+#include <algorithm>
+#include <assert.h>
+#include <limits>
+#include <math.h>
+#include <type_traits>
+#include <vector>
+
+#include "matrix.hpp"
+#include "thread_pool.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define REDUCTIONS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace matrix
+{
+
+    /*!
+     * Direction of a partial reduction
+     * rowwise : every row is reduced to a single value, the result is a rows x 1 matrix
+     * colwise : every column is reduced to a single value, the result is a 1 x cols matrix
+     */
+    enum class Direction
+    {
+        rowwise,
+        colwise
+    };
+
+    /*
+     * Reduction operations: the identity, step (fold one element into a partial result)
+     * and merge (combine two partial results). The AVX2 versions of step and merge work on 8 floats at once.
+     */
+    struct SumOp
+    {
+        template<typename A>
+        static A identity()
+        {
+            return 0;
+        }
+
+        template<typename A>
+        static A step(A acc, A x)
+        {
+            return acc + x;
+        }
+
+        template<typename A>
+        static A merge(A a, A b)
+        {
+            return a + b;
+        }
+
+#ifdef REDUCTIONS_X86
+        __attribute__((target("avx2,fma")))
+        static __m256 step(__m256 acc, __m256 x)
+        {
+            return _mm256_add_ps(acc, x);
+        }
+
+        __attribute__((target("avx2,fma")))
+        static __m256 merge(__m256 a, __m256 b)
+        {
+            return _mm256_add_ps(a, b);
+        }
+#endif
+    };
+
+    struct SquaredSumOp
+    {
+        template<typename A>
+        static A identity()
+        {
+            return 0;
+        }
+
+        template<typename A>
+        static A step(A acc, A x)
+        {
+            return acc + x * x;
+        }
+
+        template<typename A>
+        static A merge(A a, A b)
+        {
+            return a + b;
+        }
+
+#ifdef REDUCTIONS_X86
+        __attribute__((target("avx2,fma")))
+        static __m256 step(__m256 acc, __m256 x)
+        {
+            return _mm256_fmadd_ps(x, x, acc);
+        }
+
+        __attribute__((target("avx2,fma")))
+        static __m256 merge(__m256 a, __m256 b)
+        {
+            return _mm256_add_ps(a, b);
+        }
+#endif
+    };
+
+    struct AbsSumOp
+    {
+        template<typename A>
+        static A identity()
+        {
+            return 0;
+        }
+
+        template<typename A>
+        static A step(A acc, A x)
+        {
+            return acc + fabs(x);
+        }
+
+        template<typename A>
+        static A merge(A a, A b)
+        {
+            return a + b;
+        }
+
+#ifdef REDUCTIONS_X86
+        __attribute__((target("avx2,fma")))
+        static __m256 step(__m256 acc, __m256 x)
+        {
+            return _mm256_add_ps(acc, _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x));
+        }
+
+        __attribute__((target("avx2,fma")))
+        static __m256 merge(__m256 a, __m256 b)
+        {
+            return _mm256_add_ps(a, b);
+        }
+#endif
+    };
+
+    struct MaxOp
+    {
+        template<typename A>
+        static A identity()
+        {
+            return -std::numeric_limits<A>::infinity();
+        }
+
+        template<typename A>
+        static A step(A acc, A x)
+        {
+            return x > acc ? x : acc;
+        }
+
+        template<typename A>
+        static A merge(A a, A b)
+        {
+            return b > a ? b : a;
+        }
+
+#ifdef REDUCTIONS_X86
+        __attribute__((target("avx2,fma")))
+        static __m256 step(__m256 acc, __m256 x)
+        {
+            return _mm256_max_ps(x, acc);
+        }
+
+        __attribute__((target("avx2,fma")))
+        static __m256 merge(__m256 a, __m256 b)
+        {
+            return _mm256_max_ps(b, a);
+        }
+#endif
+    };
+
+    struct MinOp
+    {
+        template<typename A>
+        static A identity()
+        {
+            return std::numeric_limits<A>::infinity();
+        }
+
+        template<typename A>
+        static A step(A acc, A x)
+        {
+            return x < acc ? x : acc;
+        }
+
+        template<typename A>
+        static A merge(A a, A b)
+        {
+            return b < a ? b : a;
+        }
+
+#ifdef REDUCTIONS_X86
+        __attribute__((target("avx2,fma")))
+        static __m256 step(__m256 acc, __m256 x)
+        {
+            return _mm256_min_ps(x, acc);
+        }
+
+        __attribute__((target("avx2,fma")))
+        static __m256 merge(__m256 a, __m256 b)
+        {
+            return _mm256_min_ps(b, a);
+        }
+#endif
+    };
+
+    struct AbsMaxOp
+    {
+        template<typename A>
+        static A identity()
+        {
+            return 0;
+        }
+
+        template<typename A>
+        static A step(A acc, A x)
+        {
+            auto y = fabs(x);
+            return y > acc ? y : acc;
+        }
+
+        template<typename A>
+        static A merge(A a, A b)
+        {
+            return b > a ? b : a;
+        }
+
+#ifdef REDUCTIONS_X86
+        __attribute__((target("avx2,fma")))
+        static __m256 step(__m256 acc, __m256 x)
+        {
+            return _mm256_max_ps(_mm256_andnot_ps(_mm256_set1_ps(-0.0f), x), acc);
+        }
+
+        __attribute__((target("avx2,fma")))
+        static __m256 merge(__m256 a, __m256 b)
+        {
+            return _mm256_max_ps(b, a);
+        }
+#endif
+    };
+
+    /*
+     * number of elements reduced per task; fixed, so that results do not depend on the number of threads
+     */
+    const int REDUCTION_BLOCK = 4096;
+
+    /*!
+     * Reduce n contiguous elements. Several independent partial results are kept,
+     * which breaks the dependency between consecutive steps and lets the compiler vectorize.
+     */
+    template<typename Op, typename A>
+    A reduce(const A* p, int n)
+    {
+        A lanes[8];
+        std::fill(lanes, lanes + 8, Op::template identity<A>());
+        int i = 0;
+        for(; i + 8 <= n; i += 8)
+        {
+            for(int j=0; j<8; j++)
+            {
+                lanes[j] = Op::step(lanes[j], p[i + j]);
+            }
+        }
+        for(; i<n; i++)
+        {
+            lanes[0] = Op::step(lanes[0], p[i]);
+        }
+        for(int j=1; j<8; j++)
+        {
+            lanes[0] = Op::merge(lanes[0], lanes[j]);
+        }
+        return lanes[0];
+    }
+
+    /*!
+     * Fold a row of n contiguous elements into n partial results (acc[j] = step(acc[j], p[j])), for column-wise reductions.
+     */
+    template<typename Op, typename A>
+    void reduce_into(const A* p, int n, A* acc)
+    {
+        for(int j=0; j<n; j++)
+        {
+            acc[j] = Op::step(acc[j], p[j]);
+        }
+    }
+
+#ifdef REDUCTIONS_X86
+
+    bool reductions_use_avx2()
+    {
+        static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        return supported;
+    }
+
+    /*
+     * 32 floats per iteration, in four independent accumulators
+     */
+    template<typename Op>
+    __attribute__((target("avx2,fma")))
+    float reduce_avx2(const float* p, int n)
+    {
+        auto identity = _mm256_set1_ps(Op::template identity<float>());
+        auto a0 = identity, a1 = identity, a2 = identity, a3 = identity;
+        int i = 0;
+        for(; i + 32 <= n; i += 32)
+        {
+            a0 = Op::step(a0, _mm256_loadu_ps(p + i));
+            a1 = Op::step(a1, _mm256_loadu_ps(p + i + 8));
+            a2 = Op::step(a2, _mm256_loadu_ps(p + i + 16));
+            a3 = Op::step(a3, _mm256_loadu_ps(p + i + 24));
+        }
+        for(; i + 8 <= n; i += 8)
+        {
+            a0 = Op::step(a0, _mm256_loadu_ps(p + i));
+        }
+        a0 = Op::merge(Op::merge(a0, a1), Op::merge(a2, a3));
+        float lanes[8];
+        _mm256_storeu_ps(lanes, a0);
+        auto out = lanes[0];
+        for(int j=1; j<8; j++)
+        {
+            out = Op::merge(out, lanes[j]);
+        }
+        for(; i<n; i++)
+        {
+            out = Op::step(out, p[i]);
+        }
+        return out;
+    }
+
+    template<typename Op>
+    __attribute__((target("avx2,fma")))
+    void reduce_into_avx2(const float* p, int n, float* acc)
+    {
+        int j = 0;
+        for(; j + 8 <= n; j += 8)
+        {
+            _mm256_storeu_ps(acc + j, Op::step(_mm256_loadu_ps(acc + j), _mm256_loadu_ps(p + j)));
+        }
+        for(; j<n; j++)
+        {
+            acc[j] = Op::step(acc[j], p[j]);
+        }
+    }
+
+    template<typename Op>
+    float reduce(const float* p, int n)
+    {
+        if(reductions_use_avx2())
+        {
+            return reduce_avx2<Op>(p, n);
+        }
+        return reduce<Op, float>(p, n);
+    }
+
+    template<typename Op>
+    void reduce_into(const float* p, int n, float* acc)
+    {
+        if(reductions_use_avx2())
+        {
+            reduce_into_avx2<Op>(p, n, acc);
+            return;
+        }
+        reduce_into<Op, float>(p, n, acc);
+    }
+
+#else
+
+    template<typename Op>
+    float reduce(const float* p, int n)
+    {
+        return reduce<Op, float>(p, n);
+    }
+
+    template<typename Op>
+    void reduce_into(const float* p, int n, float* acc)
+    {
+        reduce_into<Op, float>(p, n, acc);
+    }
+
+#endif
+
+    template<typename Op>
+    double reduce(const double* p, int n)
+    {
+        return reduce<Op, double>(p, n);
+    }
+
+    template<typename Op>
+    void reduce_into(const double* p, int n, double* acc)
+    {
+        reduce_into<Op, double>(p, n, acc);
+    }
+
+    /*
+     * type of the elements of an expression (float, or double)
+     */
+    template<typename E>
+    using element_type = typename std::decay<decltype(std::declval<const E&>()(0))>::type;
+
+    /*
+     * return a pointer to elements [begin .. begin + n) of an expression:
+     * matrices of floats or doubles are read in place, anything else is evaluated into buffer first
+     */
+    template<typename T, typename = typename std::enable_if<std::is_same<accumulator_type<T>, T>::value>::type>
+    const T* elements(const Terminal<T>& e, int begin, int n, T* buffer)
+    {
+        return e.data + begin;
+    }
+
+    template<typename E>
+    const element_type<E>* elements(const E& e, int begin, int n, element_type<E>* buffer)
+    {
+        for(int i=0; i<n; i++)
+        {
+            buffer[i] = e(begin + i);
+        }
+        return buffer;
+    }
+
+    /*
+     * reduce elements [begin .. end) of an expression
+     */
+    template<typename Op, typename E>
+    element_type<E> reduce_range(const E& e, int begin, int end)
+    {
+        typedef element_type<E> A;
+        A buffer[REDUCTION_BLOCK];
+        auto out = Op::template identity<A>();
+        for(int i=begin; i<end; i+=REDUCTION_BLOCK)
+        {
+            auto n = std::min(REDUCTION_BLOCK, end - i);
+            out = Op::merge(out, reduce<Op>(elements(e, i, n, buffer), n));
+        }
+        return out;
+    }
+
+    /*!
+     * Reduce all elements of a matrix or expression to a single value.
+     * Blocks of REDUCTION_BLOCK elements are reduced in parallel (with SIMD), and merged in order.
+     */
+    template<typename Op, typename L>
+    element_type<expression_type<L>> reduce_all(const L& l)
+    {
+        auto e = as_expression(l);
+        typedef element_type<decltype(e)> A;
+        auto size = e.rows() * e.cols();
+        auto blocks = (size + REDUCTION_BLOCK - 1) / REDUCTION_BLOCK;
+        if(blocks <= 1)
+        {
+            return reduce_range<Op>(e, 0, size);
+        }
+        std::vector<A> partials(blocks);
+        parallel::parallel_for(0, blocks, REDUCTION_BLOCK, [&e, &partials, size](int begin, int end)
+        {
+            for(int b=begin; b<end; b++)
+            {
+                partials[b] = reduce_range<Op>(e, b * REDUCTION_BLOCK, std::min(size, (b + 1) * REDUCTION_BLOCK));
+            }
+        });
+        auto out = partials[0];
+        for(int b=1; b<blocks; b++)
+        {
+            out = Op::merge(out, partials[b]);
+        }
+        return out;
+    }
+
+    /*!
+     * Reduce every row (Direction::rowwise) or every column (Direction::colwise) of a matrix or expression.
+     * Rows are split over threads for row-wise reductions, columns for column-wise reductions.
+     * The result is written to out, whose storage is reused when it is large enough.
+     */
+    template<typename Op, typename L>
+    void reduce_partial(const L& l, Direction direction, BasicMatrix<element_type<expression_type<L>>>& out)
+    {
+        auto e = as_expression(l);
+        typedef element_type<decltype(e)> A;
+        auto R = e.rows();
+        auto C = e.cols();
+        if(direction == Direction::rowwise)
+        {
+            out.resize(R, 1);
+            auto po = out.data();
+            parallel::parallel_for(0, R, C, [&e, po, C](int begin, int end)
+            {
+                for(int i=begin; i<end; i++)
+                {
+                    po[i] = reduce_range<Op>(e, i * C, (i + 1) * C);
+                }
+            });
+            return;
+        }
+        out.resize(1, C);
+        auto po = out.data();
+        std::fill(po, po + C, Op::template identity<A>());
+        parallel::parallel_for(0, C, R, [&e, po, R, C](int begin, int end)
+        {
+            A buffer[REDUCTION_BLOCK];
+            for(int j=begin; j<end; j+=REDUCTION_BLOCK)
+            {
+                auto n = std::min(REDUCTION_BLOCK, end - j);
+                for(int i=0; i<R; i++)
+                {
+                    reduce_into<Op>(elements(e, i * C + j, n, buffer), n, po + j);
+                }
+            }
+        });
+    }
+
+    template<typename Op, typename L>
+    BasicMatrix<element_type<expression_type<L>>> reduce_partial(const L& l, Direction direction)
+    {
+        BasicMatrix<element_type<expression_type<L>>> out;
+        reduce_partial<Op>(l, direction, out);
+        return out;
+    }
+
+    template<typename L>
+    using enable_if_operand = typename std::enable_if<is_operand<L>::value>::type;
+
+    /*! return the sum of all elements of a matrix or expression
+     */
+    template<typename L, typename = enable_if_operand<L>>
+    element_type<expression_type<L>> sum(const L& l)
+    {
+        return reduce_all<SumOp>(l);
+    }
+
+    /*! return the mean of all elements of a matrix or expression
+     */
+    template<typename L, typename = enable_if_operand<L>>
+    element_type<expression_type<L>> mean(const L& l)
+    {
+        auto e = as_expression(l);
+        assert(e.rows() * e.cols() > 0);
+        return reduce_all<SumOp>(e) / (e.rows() * e.cols());
+    }
+
+    /*! return the largest element of a matrix or expression
+     */
+    template<typename L, typename = enable_if_operand<L>>
+    element_type<expression_type<L>> max(const L& l)
+    {
+        auto e = as_expression(l);
+        assert(e.rows() > 0);
+        assert(e.cols() > 0);
+        return reduce_all<MaxOp>(e);
+    }
+
+    /*! return the smallest element of a matrix or expression
+     */
+    template<typename L, typename = enable_if_operand<L>>
+    element_type<expression_type<L>> min(const L& l)
+    {
+        auto e = as_expression(l);
+        assert(e.rows() > 0);
+        assert(e.cols() > 0);
+        return reduce_all<MinOp>(e);
+    }
+
+    /*! return the sum of the squares of all elements
+     */
+    template<typename L, typename = enable_if_operand<L>>
+    element_type<expression_type<L>> squared_norm(const L& l)
+    {
+        return reduce_all<SquaredSumOp>(l);
+    }
+
+    /*! return the Euclidean (Frobenius) norm, the square root of the sum of squares
+     */
+    template<typename L, typename = enable_if_operand<L>>
+    element_type<expression_type<L>> norm(const L& l)
+    {
+        return sqrt(reduce_all<SquaredSumOp>(l));
+    }
+
+    /*! return the L1 norm, the sum of absolute values
+     */
+    template<typename L, typename = enable_if_operand<L>>
+    element_type<expression_type<L>> norm1(const L& l)
+    {
+        return reduce_all<AbsSumOp>(l);
+    }
+
+    /*! return the maximum norm, the largest absolute value
+     */
+    template<typename L, typename = enable_if_operand<L>>
+    element_type<expression_type<L>> norm_inf(const L& l)
+    {
+        return reduce_all<AbsMaxOp>(l);
+    }
+
+    /*! return the sums of every row or every column
+     */
+    template<typename L, typename = enable_if_operand<L>>
+    BasicMatrix<element_type<expression_type<L>>> sum(const L& l, Direction direction)
+    {
+        return reduce_partial<SumOp>(l, direction);
+    }
+
+    /*! return the means of every row or every column
+     */
+    template<typename L, typename = enable_if_operand<L>>
+    BasicMatrix<element_type<expression_type<L>>> mean(const L& l, Direction direction)
+    {
+        auto e = as_expression(l);
+        auto out = reduce_partial<SumOp>(e, direction);
+        auto n = direction == Direction::rowwise ? e.cols() : e.rows();
+        assert(n > 0);
+        out *= 1.0 / n;
+        return out;
+    }
+
+    /*! return the largest element of every row or every column
+     */
+    template<typename L, typename = enable_if_operand<L>>
+    BasicMatrix<element_type<expression_type<L>>> max(const L& l, Direction direction)
+    {
+        return reduce_partial<MaxOp>(l, direction);
+    }
+
+    /*! return the smallest element of every row or every column
+     */
+    template<typename L, typename = enable_if_operand<L>>
+    BasicMatrix<element_type<expression_type<L>>> min(const L& l, Direction direction)
+    {
+        return reduce_partial<MinOp>(l, direction);
+    }
+
+    /*! return the sums of squares of every row or every column
+     */
+    template<typename L, typename = enable_if_operand<L>>
+    BasicMatrix<element_type<expression_type<L>>> squared_norm(const L& l, Direction direction)
+    {
+        return reduce_partial<SquaredSumOp>(l, direction);
+    }
+
+    /*
+     * index of the first element of [begin .. end) equal to the maximum m (found with a vectorized max first)
+     */
+    template<typename E, typename A>
+    int find_first(const E& e, int begin, int end, A m)
+    {
+        for(int i=begin; i<end; i++)
+        {
+            if(e(i) == m)
+            {
+                return i;
+            }
+        }
+        return begin;
+    }
+
+    /*! return the (row-major) index of the largest element of a matrix or expression, the first one in case of ties
+     */
+    template<typename L, typename = enable_if_operand<L>>
+    int argmax(const L& l)
+    {
+        auto e = as_expression(l);
+        return find_first(e, 0, e.rows() * e.cols(), max(e));
+    }
+
+    /*! return the index of the largest element of every row (Direction::rowwise, e.g. the predicted class of every example)
+     * or the row index of the largest element of every column (Direction::colwise)
+     */
+    template<typename L, typename = enable_if_operand<L>>
+    std::vector<int> argmax(const L& l, Direction direction)
+    {
+        auto e = as_expression(l);
+        auto R = e.rows();
+        auto C = e.cols();
+        auto maxima = reduce_partial<MaxOp>(e, direction);
+        if(direction == Direction::rowwise)
+        {
+            std::vector<int> out(R);
+            for(int i=0; i<R; i++)
+            {
+                out[i] = find_first(e, i * C, (i + 1) * C, maxima(i, 0)) - i * C;
+            }
+            return out;
+        }
+        std::vector<int> out(C, -1);
+        for(int i=0; i<R; i++)
+        {
+            for(int j=0; j<C; j++)
+            {
+                if(out[j] == -1 && e(i * C + j) == maxima(0, j))
+                {
+                    out[j] = i;
+                }
+            }
+        }
+        return out;
+    }
+
+}
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <assert.h>
+#include <atomic>
+#include <math.h>
+#include <stdint.h>
+
+namespace rng
+{
+
+    /*!
+     * SplitMix64, used to expand a single 64 bit seed into the state of a larger generator.
+     */
+    uint64_t splitmix64(uint64_t& state)
+    {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    /*!
+     * xoshiro256** pseudo random number generator (Blackman and Vigna).
+     * Fast, small (32 bytes of state) and statistically strong. jump() advances the state by 2^128 steps,
+     * which splits the sequence into non-overlapping streams (one per thread).
+     * Satisfies the UniformRandomBitGenerator requirements, so it also works with <random> distributions.
+     */
+    class Generator
+    {
+        public:
+
+            typedef uint64_t result_type;
+
+            explicit Generator(uint64_t seed = 0)
+            {
+                this->seed(seed);
+            }
+
+            void seed(uint64_t seed)
+            {
+                for(int i=0; i<4; i++)
+                {
+                    s_[i] = splitmix64(seed);
+                }
+            }
+
+            static constexpr uint64_t min()
+            {
+                return 0;
+            }
+
+            static constexpr uint64_t max()
+            {
+                return UINT64_MAX;
+            }
+
+            uint64_t operator()()
+            {
+                auto result = rotl(s_[1] * 5, 7) * 9;
+                auto t = s_[1] << 17;
+                s_[2] ^= s_[0];
+                s_[3] ^= s_[1];
+                s_[1] ^= s_[2];
+                s_[0] ^= s_[3];
+                s_[2] ^= t;
+                s_[3] = rotl(s_[3], 45);
+                return result;
+            }
+
+            /*! return a float drawn uniformly from [0 .. 1)
+             */
+            float uniform()
+            {
+                return ((*this)() >> 40) * (1.0f / 16777216.0f);
+            }
+
+            /*! return a float drawn uniformly from [lo .. hi)
+             */
+            float uniform(float lo, float hi)
+            {
+                return lo + (hi - lo) * uniform();
+            }
+
+            /*! return an integer drawn uniformly from [0 .. n), without modulo bias
+             */
+            uint64_t uniform_int(uint64_t n)
+            {
+                assert(n > 0);
+                auto threshold = (0 - n) % n;
+                while(true)
+                {
+                    auto r = (*this)();
+                    if(r >= threshold)
+                    {
+                        return r % n;
+                    }
+                }
+            }
+
+            /*! return a float drawn from the normal distribution N(mean, stddev^2) (Box-Muller transform)
+             */
+            float normal(float mean = 0.0f, float stddev = 1.0f)
+            {
+                auto u0 = ((*this)() >> 11) * (1.0 / 9007199254740992.0);
+                auto u1 = ((*this)() >> 11) * (1.0 / 9007199254740992.0);
+                auto r = sqrt(-2.0 * log(1.0 - u0));
+                return mean + stddev * (float)(r * cos(2.0 * M_PI * u1));
+            }
+
+            /*! advance the generator by 2^128 steps
+             */
+            void jump()
+            {
+                static const uint64_t JUMP[] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+                uint64_t s[4] = {0, 0, 0, 0};
+                for(int i=0; i<4; i++)
+                {
+                    for(int b=0; b<64; b++)
+                    {
+                        if(JUMP[i] & (1ULL << b))
+                        {
+                            for(int j=0; j<4; j++)
+                            {
+                                s[j] ^= s_[j];
+                            }
+                        }
+                        (*this)();
+                    }
+                }
+                for(int j=0; j<4; j++)
+                {
+                    s_[j] = s[j];
+                }
+            }
+
+        private:
+
+            static uint64_t rotl(uint64_t x, int k)
+            {
+                return (x << k) | (x >> (64 - k));
+            }
+
+            uint64_t s_[4];
+    };
+
+    /*
+     * global seed; every change bumps the epoch, so that per-thread generators know to reseed
+     */
+    struct Seed
+    {
+        std::atomic<uint64_t> seed{5489};
+        std::atomic<uint64_t> epoch{0};
+        std::atomic<uint64_t> next_stream{0};
+    };
+
+    Seed& global_seed()
+    {
+        static Seed s;
+        return s;
+    }
+
+    /*!
+     * Set the seed for all generators returned by thread_generator().
+     * Runs that set the same seed (and draw from the same threads in the same order) produce the same numbers.
+     */
+    void set_seed(uint64_t seed)
+    {
+        auto& s = global_seed();
+        s.seed = seed;
+        s.next_stream = 0;
+        s.epoch++;
+    }
+
+    /*!
+     * Return a generator for stream number 'stream' of a given seed.
+     * Streams are 2^128 numbers apart, so they never overlap.
+     */
+    Generator stream(uint64_t seed, int stream)
+    {
+        assert(stream >= 0);
+        Generator g(seed);
+        for(int i=0; i<stream; i++)
+        {
+            g.jump();
+        }
+        return g;
+    }
+
+    /*!
+     * Return the generator of the calling thread.
+     * Every thread gets its own, independent stream of the global seed, so drawing numbers needs no locking.
+     */
+    Generator& thread_generator()
+    {
+        thread_local Generator g;
+        thread_local uint64_t epoch = UINT64_MAX;
+        auto& s = global_seed();
+        if(epoch != s.epoch)
+        {
+            epoch = s.epoch;
+            g = stream(s.seed, s.next_stream++);
+        }
+        return g;
+    }
+
+}
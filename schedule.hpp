@@ -0,0 +1,262 @@
+#pragma once
+
+#include <algorithm>
+#include <assert.h>
+#include <functional>
+#include <limits>
+#include <math.h>
+
+namespace optim
+{
+
+    /*!
+     * A learning rate schedule gives the learning rate for every iteration (or epoch) of a training loop.
+     * Training loops report the loss of every iteration with observe(), so schedules can adapt to it
+     * (e.g. ReduceOnPlateau); schedules that only depend on the iteration nr ignore it.
+     * Schedules may keep state, so a schedule object drives a single training run at a time (see reset()).
+     */
+    class Schedule
+    {
+        public:
+
+            virtual ~Schedule()
+            {
+            }
+
+            /*! return the learning rate for iteration iteration_nr
+             */
+            virtual float learning_rate(int iteration_nr) = 0;
+
+            /*! report the loss of the last iteration
+             */
+            virtual void observe(float loss)
+            {
+            }
+
+            /*! forget all state, e.g. to start a new training run
+             */
+            virtual void reset()
+            {
+            }
+
+            float operator()(int iteration_nr)
+            {
+                return learning_rate(iteration_nr);
+            }
+    };
+
+    /*!
+     * A schedule given by a function of the iteration nr (e.g. numeric::step_decay_learning_rate).
+     */
+    class FunctionSchedule : public Schedule
+    {
+        public:
+
+            FunctionSchedule(const std::function<float(int)>& function)
+                : function_(function)
+            {
+            }
+
+            float learning_rate(int iteration_nr) override
+            {
+                return function_(iteration_nr);
+            }
+
+        private:
+
+            std::function<float(int)> function_;
+    };
+
+    /*!
+     * Reduce on plateau: keeps the learning rate until the loss stops improving (by more than the relative threshold)
+     * for more than patience iterations, then multiplies it by factor (but not below min_learning_rate).
+     * After a reduction, the loss is given cooldown iterations to respond before it is watched again.
+     */
+    class ReduceOnPlateau : public Schedule
+    {
+        public:
+
+            ReduceOnPlateau(float initial_learning_rate, float factor = 0.5f, int patience = 10, float threshold = 1e-4f, int cooldown = 0, float min_learning_rate = 0.0f)
+                : initial_learning_rate_(initial_learning_rate), factor_(factor), patience_(patience), threshold_(threshold), cooldown_(cooldown),
+                  min_learning_rate_(min_learning_rate)
+            {
+                assert(factor > 0.0f && factor < 1.0f);
+                assert(patience >= 0);
+                assert(cooldown >= 0);
+                reset();
+            }
+
+            float learning_rate(int iteration_nr) override
+            {
+                return learning_rate_;
+            }
+
+            void observe(float loss) override
+            {
+                if(loss < best_ - threshold_ * fabs(best_))
+                {
+                    best_ = loss;
+                    bad_iterations_ = 0;
+                }
+                else
+                {
+                    bad_iterations_++;
+                }
+                if(cooldown_left_ > 0)
+                {
+                    cooldown_left_--;
+                    bad_iterations_ = 0;
+                }
+                if(bad_iterations_ > patience_)
+                {
+                    learning_rate_ = std::max(learning_rate_ * factor_, min_learning_rate_);
+                    cooldown_left_ = cooldown_;
+                    bad_iterations_ = 0;
+                }
+            }
+
+            void reset() override
+            {
+                learning_rate_ = initial_learning_rate_;
+                best_ = std::numeric_limits<float>::max();
+                bad_iterations_ = 0;
+                cooldown_left_ = 0;
+            }
+
+        private:
+
+            float initial_learning_rate_;
+            float factor_;
+            int patience_;
+            float threshold_;
+            int cooldown_;
+            float min_learning_rate_;
+            float learning_rate_;
+            float best_;
+            int bad_iterations_;
+            int cooldown_left_;
+    };
+
+    /*!
+     * Cosine annealing with warm restarts (SGDR): the learning rate follows half a cosine from max_learning_rate
+     * down to min_learning_rate over a cycle, then restarts at max_learning_rate.
+     * The first cycle lasts period iterations, every next cycle period_multiplier times as long.
+     */
+    class CosineRestarts : public Schedule
+    {
+        public:
+
+            CosineRestarts(float max_learning_rate, int period, int period_multiplier = 2, float min_learning_rate = 0.0f)
+                : max_learning_rate_(max_learning_rate), min_learning_rate_(min_learning_rate), period_(period), period_multiplier_(period_multiplier)
+            {
+                assert(period >= 1);
+                assert(period_multiplier >= 1);
+                assert(min_learning_rate <= max_learning_rate);
+            }
+
+            float learning_rate(int iteration_nr) override
+            {
+                // position within the current cycle
+                long t = iteration_nr;
+                long cycle = period_;
+                while(t >= cycle)
+                {
+                    t -= cycle;
+                    cycle *= period_multiplier_;
+                }
+                return min_learning_rate_ + 0.5f * (max_learning_rate_ - min_learning_rate_) * (1.0f + cos(M_PI * t / cycle));
+            }
+
+        private:
+
+            float max_learning_rate_;
+            float min_learning_rate_;
+            int period_;
+            int period_multiplier_;
+    };
+
+    /*!
+     * Linear warmup: scales the learning rate of another schedule up linearly over the first warmup_iterations,
+     * (iteration i gets (i + 1) / warmup_iterations of it), then follows it. Losses are passed on to it.
+     * The other schedule is referenced, not copied, so it must outlive the warmup.
+     */
+    class Warmup : public Schedule
+    {
+        public:
+
+            Warmup(Schedule& schedule, int warmup_iterations)
+                : schedule_(schedule), warmup_iterations_(warmup_iterations)
+            {
+                assert(warmup_iterations >= 1);
+            }
+
+            float learning_rate(int iteration_nr) override
+            {
+                auto learning_rate = schedule_.learning_rate(iteration_nr);
+                if(iteration_nr < warmup_iterations_)
+                {
+                    learning_rate *= (iteration_nr + 1.0f) / warmup_iterations_;
+                }
+                return learning_rate;
+            }
+
+            void observe(float loss) override
+            {
+                schedule_.observe(loss);
+            }
+
+            void reset() override
+            {
+                schedule_.reset();
+            }
+
+        private:
+
+            Schedule& schedule_;
+            int warmup_iterations_;
+    };
+
+    /*!
+     * One-cycle: over the first warmup_fraction of total_iterations the learning rate rises (along a cosine)
+     * from max_learning_rate / div_factor to max_learning_rate, then anneals to max_learning_rate / (div_factor * final_div_factor)
+     * at total_iterations, where it stays.
+     */
+    class OneCycle : public Schedule
+    {
+        public:
+
+            OneCycle(float max_learning_rate, int total_iterations, float warmup_fraction = 0.3f, float div_factor = 25.0f, float final_div_factor = 1e4f)
+                : max_learning_rate_(max_learning_rate), total_iterations_(total_iterations), div_factor_(div_factor), final_div_factor_(final_div_factor)
+            {
+                assert(total_iterations >= 2);
+                assert(warmup_fraction >= 0.0f && warmup_fraction < 1.0f);
+                assert(div_factor >= 1.0f && final_div_factor >= 1.0f);
+                warmup_iterations_ = std::max(1, (int) (warmup_fraction * total_iterations));
+            }
+
+            float learning_rate(int iteration_nr) override
+            {
+                // cosine from a to b over [0 .. 1]
+                auto anneal = [](float a, float b, float t)
+                {
+                    return b + 0.5f * (a - b) * (1.0f + cos(M_PI * t));
+                };
+                auto initial_learning_rate = max_learning_rate_ / div_factor_;
+                if(iteration_nr < warmup_iterations_)
+                {
+                    return anneal(initial_learning_rate, max_learning_rate_, (float) iteration_nr / warmup_iterations_);
+                }
+                auto t = std::min(1.0f, (float) (iteration_nr - warmup_iterations_) / (total_iterations_ - warmup_iterations_));
+                return anneal(max_learning_rate_, initial_learning_rate / final_div_factor_, t);
+            }
+
+        private:
+
+            float max_learning_rate_;
+            int total_iterations_;
+            int warmup_iterations_;
+            float div_factor_;
+            float final_div_factor_;
+    };
+
+}
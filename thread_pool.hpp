@@ -0,0 +1,263 @@
+#pragma once
+
+#include <algorithm>
+#include <assert.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel
+{
+
+    /*!
+     * A fixed set of worker threads that execute batches of indexed tasks.
+     * The thread calling run() takes part in the work, so a pool with N workers uses N + 1 threads.
+     */
+    class ThreadPool
+    {
+        public:
+
+            ThreadPool(int number_of_workers)
+            {
+                assert(number_of_workers >= 0);
+                for(int i=0; i<number_of_workers; i++)
+                {
+                    workers_.emplace_back([this]()
+                    {
+                        work();
+                    });
+                }
+            }
+
+            ~ThreadPool()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    stop_ = true;
+                }
+                wake_.notify_all();
+                for(auto& t : workers_)
+                {
+                    t.join();
+                }
+            }
+
+            /*! return the number of threads that take part in run() (workers plus the calling thread)
+             */
+            int size() const
+            {
+                return workers_.size() + 1;
+            }
+
+            /*!
+             * Execute task(0) .. task(number_of_tasks - 1) and return when all of them are finished.
+             * Calls made from inside a task, or while another batch is running, execute serially on the calling thread.
+             */
+            void run(int number_of_tasks, const std::function<void(int)>& task)
+            {
+                if(inside_task() || workers_.empty() || number_of_tasks <= 1)
+                {
+                    for(int i=0; i<number_of_tasks; i++)
+                    {
+                        task(i);
+                    }
+                    return;
+                }
+                std::unique_lock<std::mutex> busy(busy_, std::try_to_lock);
+                if(!busy.owns_lock())
+                {
+                    for(int i=0; i<number_of_tasks; i++)
+                    {
+                        task(i);
+                    }
+                    return;
+                }
+
+                // publish the batch, once no worker is still busy with the previous one
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    done_.wait(lock, [this]()
+                    {
+                        return active_workers_ == 0;
+                    });
+                    task_ = &task;
+                    number_of_tasks_ = number_of_tasks;
+                    next_task_ = 0;
+                    unfinished_tasks_ = number_of_tasks;
+                    batch_++;
+                }
+                wake_.notify_all();
+
+                // take part in the work
+                inside_task() = true;
+                execute_tasks();
+                inside_task() = false;
+
+                // wait for the workers
+                std::unique_lock<std::mutex> lock(mutex_);
+                done_.wait(lock, [this]()
+                {
+                    return unfinished_tasks_ == 0;
+                });
+                task_ = nullptr;
+            }
+
+        private:
+
+            /*
+             * true on worker threads, and on the calling thread while it takes part in a batch
+             */
+            static bool& inside_task()
+            {
+                thread_local bool inside = false;
+                return inside;
+            }
+
+            void execute_tasks()
+            {
+                while(true)
+                {
+                    auto i = next_task_++;
+                    if(i >= number_of_tasks_)
+                    {
+                        return;
+                    }
+                    (*task_)(i);
+                    if(--unfinished_tasks_ == 0)
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        done_.notify_all();
+                    }
+                }
+            }
+
+            void work()
+            {
+                inside_task() = true;
+                long seen_batch = 0;
+                while(true)
+                {
+                    {
+                        std::unique_lock<std::mutex> lock(mutex_);
+                        wake_.wait(lock, [this, seen_batch]()
+                        {
+                            return stop_ || batch_ != seen_batch;
+                        });
+                        if(stop_)
+                        {
+                            return;
+                        }
+                        seen_batch = batch_;
+                        active_workers_++;
+                    }
+                    execute_tasks();
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        active_workers_--;
+                    }
+                    done_.notify_all();
+                }
+            }
+
+            std::vector<std::thread> workers_;
+            std::mutex busy_;
+            std::mutex mutex_;
+            std::condition_variable wake_;
+            std::condition_variable done_;
+            const std::function<void(int)>* task_ = nullptr;
+            std::atomic<int> number_of_tasks_{0};
+            std::atomic<int> next_task_{0};
+            std::atomic<int> unfinished_tasks_{0};
+            int active_workers_ = 0;
+            long batch_ = 0;
+            bool stop_ = false;
+    };
+
+    /*
+     * global settings
+     */
+    struct Settings
+    {
+        int number_of_threads = std::max(1u, std::thread::hardware_concurrency());
+        long serial_threshold = 1 << 16;
+        std::unique_ptr<ThreadPool> pool;
+    };
+
+    Settings& settings()
+    {
+        static Settings s;
+        return s;
+    }
+
+    /*! set the number of threads used by parallel operations (1 disables parallelism)
+     */
+    void set_number_of_threads(int number_of_threads)
+    {
+        assert(number_of_threads >= 1);
+        settings().number_of_threads = number_of_threads;
+        settings().pool.reset();
+    }
+
+    int number_of_threads()
+    {
+        return settings().number_of_threads;
+    }
+
+    /*! set the amount of work (roughly: number of multiply-adds) below which operations are not split over threads
+     */
+    void set_serial_threshold(long serial_threshold)
+    {
+        assert(serial_threshold >= 0);
+        settings().serial_threshold = serial_threshold;
+    }
+
+    long serial_threshold()
+    {
+        return settings().serial_threshold;
+    }
+
+    /*! return the shared thread pool, created on first use
+     */
+    ThreadPool& default_pool()
+    {
+        auto& s = settings();
+        if(!s.pool)
+        {
+            s.pool.reset(new ThreadPool(s.number_of_threads - 1));
+        }
+        return *s.pool;
+    }
+
+    /*!
+     * Split [begin .. end) into contiguous chunks and call f(chunk_begin, chunk_end) for each of them, in parallel.
+     * cost_per_item is the (approximate) amount of work per index. When the total amount of work is below the serial threshold,
+     * f is called once on the calling thread, without touching the pool.
+     */
+    template<typename F>
+    void parallel_for(int begin, int end, long cost_per_item, const F& f)
+    {
+        if(end <= begin)
+        {
+            return;
+        }
+        long n = end - begin;
+        long work = n * std::max(1L, cost_per_item);
+        long chunks = std::min<long>(number_of_threads(), std::min(n, work / std::max(1L, serial_threshold())));
+        if(chunks <= 1)
+        {
+            f(begin, end);
+            return;
+        }
+        default_pool().run(chunks, [begin, n, chunks, &f](int i)
+        {
+            auto chunk_begin = begin + (int)(n * i / chunks);
+            auto chunk_end = begin + (int)(n * (i + 1) / chunks);
+            f(chunk_begin, chunk_end);
+        });
+    }
+
+}
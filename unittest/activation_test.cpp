@@ -0,0 +1,98 @@
+#include "../activation.hpp"
+#include "../matrix.hpp"
+
+#include <assert.h>
+#include <chrono>
+#include <iostream>
+#include <math.h>
+#include <string>
+#include <vector>
+
+/*
+ * compare a (vectorized) activation function against a reference, on [-20 .. 20]
+ */
+template<typename F, typename R>
+float max_error(const F& f, const R& reference, bool relative)
+{
+    std::vector<float> xs;
+    for(int i=-20000; i<=20000; i++)
+    {
+        xs.push_back(i * 0.001f);
+    }
+    std::vector<float> ys(xs.size());
+    f.apply(xs.data(), ys.data(), xs.size());
+    auto out = 0.0;
+    for(int i=0; i<xs.size(); i++)
+    {
+        auto y = reference((double) xs[i]);
+        auto err = fabs(ys[i] - y);
+        if(relative)
+        {
+            err /= fabs(y);
+        }
+        // the scalar version must agree with the vectorized version
+        auto err_scalar = fabs(f(xs[i]) - y);
+        if(relative)
+        {
+            err_scalar /= fabs(y);
+        }
+        out = std::max(out, std::max(err, err_scalar));
+    }
+    return out;
+}
+
+template<activation::Accuracy A>
+void test_activation_accuracy(const std::string& name, float tolerance)
+{
+    auto exp_err = max_error(activation::Exp<A>(), [](double x)
+    {
+        return exp(x);
+    }, true);
+    auto sigmoid_err = max_error(activation::Sigmoid<A>(), [](double x)
+    {
+        return 1.0 / (1.0 + exp(-x));
+    }, false);
+    auto tanh_err = max_error(activation::Tanh<A>(), [](double x)
+    {
+        return tanh(x);
+    }, false);
+
+    std::cout << std::endl;
+    std::cout << "accuracy : " << name << std::endl;
+    std::cout << "exp, max relative error : " << exp_err << std::endl;
+    std::cout << "sigmoid, max absolute error : " << sigmoid_err << std::endl;
+    std::cout << "tanh, max absolute error : " << tanh_err << std::endl;
+    assert(exp_err < tolerance);
+    assert(sigmoid_err < tolerance);
+    assert(tanh_err < tolerance);
+}
+
+/*
+ * time apply_function with a plain lambda and with the vectorized sigmoid
+ */
+void test_activation_speed()
+{
+    auto m = matrix::random(1024, 1024);
+    auto lambda = [](float x)
+    {
+        return 1.0f / (1.0f + exp(-x));
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    auto a = matrix::apply_function(m, lambda);
+    auto middle = std::chrono::steady_clock::now();
+    auto b = matrix::apply_function(m, activation::Sigmoid<>());
+    auto stop = std::chrono::steady_clock::now();
+
+    std::cout << std::endl;
+    std::cout << "sigmoid on 1024x1024, lambda : " << std::chrono::duration<double, std::milli>(middle - start).count() << " ms" << std::endl;
+    std::cout << "sigmoid on 1024x1024, vectorized : " << std::chrono::duration<double, std::milli>(stop - middle).count() << " ms" << std::endl;
+}
+
+int main()
+{
+    test_activation_accuracy<activation::Accuracy::exact>("exact", 1e-6f);
+    test_activation_accuracy<activation::Accuracy::high>("high", 1e-6f);
+    test_activation_accuracy<activation::Accuracy::fast>("fast", 2e-3f);
+    test_activation_speed();
+}
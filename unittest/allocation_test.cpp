@@ -0,0 +1,98 @@
+#include "../gradient_descent.hpp"
+#include "../matrix.hpp"
+#include "../neural_network.hpp"
+
+#include <assert.h>
+#include <atomic>
+#include <iostream>
+#include <new>
+#include <stdlib.h>
+#include <vector>
+
+/*
+ * count every heap allocation made by the program
+ */
+std::atomic<long> number_of_allocations{0};
+
+void* operator new(size_t size)
+{
+    number_of_allocations++;
+    auto p = malloc(size == 0 ? 1 : size);
+    if(p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+/*
+ * once the workspace has been sized by a first step, training steps must not allocate
+ */
+void test_allocation_001()
+{
+    auto nn = nn::init_neural_network({2, 3, 3, 1});
+    matrix::FloatMatrix xs = {{0.0f, 0.0f}, {0.0f, 1.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}};
+    matrix::FloatMatrix ys = {{0.0f}, {1.0f}, {1.0f}, {0.0f}};
+
+    // warm up
+    nn::Workspace workspace;
+    matrix::slice_rows(xs, 0, 1, workspace.xs);
+    matrix::slice_rows(ys, 0, 1, workspace.ys);
+    nn::backpropagation(workspace.xs, workspace.ys, nn, 0.1f, workspace);
+
+    // steady state
+    auto before = number_of_allocations.load();
+    for(int i=0; i<1000; i++)
+    {
+        for(int j=0; j<matrix::rows(xs); j++)
+        {
+            matrix::slice_rows(xs, j, j + 1, workspace.xs);
+            matrix::slice_rows(ys, j, j + 1, workspace.ys);
+            nn::backpropagation(workspace.xs, workspace.ys, nn, 0.1f, workspace);
+        }
+    }
+    auto allocations = number_of_allocations.load() - before;
+
+    std::cout << std::endl;
+    std::cout << "allocations in 4000 training steps : " << allocations << std::endl;
+    assert(allocations == 0);
+}
+
+/*
+ * the number of allocations made by nn::train must not depend on the number of iterations
+ */
+void test_allocation_002()
+{
+    auto nn = nn::init_neural_network({8, 4, 4, 1});
+    auto xs = matrix::random(25, 8);
+    auto ys = matrix::random(25, 1);
+
+    auto before = number_of_allocations.load();
+    nn::train(xs, ys, nn, numeric::constant_learning_rate(0.1f), 10);
+    auto allocations_10 = number_of_allocations.load() - before;
+
+    before = number_of_allocations.load();
+    nn::train(xs, ys, nn, numeric::constant_learning_rate(0.1f), 1000);
+    auto allocations_1000 = number_of_allocations.load() - before;
+
+    std::cout << std::endl;
+    std::cout << "allocations in nn::train, 10 iterations : " << allocations_10 << std::endl;
+    std::cout << "allocations in nn::train, 1000 iterations : " << allocations_1000 << std::endl;
+    assert(allocations_10 == allocations_1000);
+}
+
+int main()
+{
+    test_allocation_001();
+    test_allocation_002();
+}
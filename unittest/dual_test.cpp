@@ -0,0 +1,145 @@
+#include "../dual.hpp"
+#include "../gradient_descent.hpp"
+#include "../logistic_regression.hpp"
+
+#include <assert.h>
+#include <iostream>
+#include <math.h>
+#include <vector>
+
+/*
+ * derivatives of elementary functions and their compositions match the analytic derivatives
+ */
+void test_dual_001()
+{
+    auto f = [](auto x)
+    {
+        return exp(sin(x)) * x / (1.0f + x * x) - sqrt(x) + pow(x, 3) + tanh(-x) + log(2.0f * x);
+    };
+    auto df = [](float x)
+    {
+        auto g = expf(sinf(x));
+        auto q = 1.0f + x * x;
+        return g * cosf(x) * x / q + g * (q - 2.0f * x * x) / (q * q) - 0.5f / sqrtf(x) + 3.0f * x * x
+               - (1.0f - tanhf(x) * tanhf(x)) + 1.0f / x;
+    };
+    std::cout << std::endl;
+    for(auto x : {0.25f, 0.5f, 1.0f, 2.0f, 3.0f})
+    {
+        auto exact = df(x);
+        auto forward = autodiff::derivative(f, x);
+        auto central = numeric::derivative([&f](float x)
+        {
+            return f(x);
+        })(x);
+        std::cout << "x : " << x << ", f'(x) : " << exact << ", forward-mode error : " << fabs(forward - exact)
+                  << ", finite difference error : " << fabs(central - exact) << std::endl;
+        assert(fabs(forward - exact) <= 1e-5f * (1.0f + fabs(exact)));
+    }
+
+    // branches follow the value, constants have no derivative
+    auto clamp = [](auto x)
+    {
+        if(x > 1.0f)
+        {
+            x = 1.0f;
+        }
+        return 3.0f * x;
+    };
+    assert(autodiff::derivative(clamp, 0.5f) == 3.0f);
+    assert(autodiff::derivative(clamp, 2.0f) == 0.0f);
+    assert(autodiff::derivative([](auto x)
+    {
+        return fabs(x);
+    }, -2.0f) == -1.0f);
+}
+
+/*
+ * gradients with more parameters than components of a dual number take several passes
+ */
+void test_dual_002()
+{
+    // f(xs) = sum_i (i + 1) * xs[i]^2 + xs[0] * xs[n - 1]
+    auto f = [](const auto& xs)
+    {
+        auto y = xs[0] * xs[xs.size() - 1];
+        for(int i=0; i<xs.size(); i++)
+        {
+            y += (i + 1.0f) * xs[i] * xs[i];
+        }
+        return y;
+    };
+    for(int n : {1, 7, 8, 9, 20})
+    {
+        std::vector<float> xs;
+        for(int i=0; i<n; i++)
+        {
+            xs.push_back(0.1f * i - 0.5f);
+        }
+        std::vector<float> ds;
+        auto y = autodiff::gradient(f, xs, ds);
+        assert(y == f(xs));
+        assert(ds.size() == n);
+        for(int i=0; i<n; i++)
+        {
+            auto exact = 2.0f * (i + 1.0f) * xs[i];
+            exact += i == 0 ? xs[n - 1] : 0.0f;
+            exact += i == n - 1 ? xs[0] : 0.0f;
+            assert(fabs(ds[i] - exact) < 1e-5f);
+        }
+    }
+}
+
+/*
+ * gradient descent with a forward-mode gradient, and logistic regression (which uses forward mode internally)
+ */
+void test_dual_003()
+{
+    auto f = [](const auto& xs)
+    {
+        return (xs[0] - 1.0f) * (xs[0] - 1.0f) + 2.0f * (xs[1] + 3.0f) * (xs[1] + 3.0f);
+    };
+    auto evaluations = 0;
+    std::function<float(std::vector<float>)> counted_f = [&f, &evaluations](std::vector<float> xs)
+    {
+        evaluations++;
+        return f(xs);
+    };
+    auto min_xs = numeric::gradient_descent(counted_f, [&f](const std::vector<float>& xs, float y, std::vector<float>& ds)
+    {
+        autodiff::gradient(f, xs, ds);
+    }, {0.0f, 0.0f}, numeric::constant_learning_rate(0.1f), 256);
+    std::cout << std::endl;
+    std::cout << "min (x - 1)^2 + 2(y + 3)^2 : " << min_xs[0] << ", " << min_xs[1] << " (" << evaluations << " evaluations)" << std::endl;
+    assert(fabs(min_xs[0] - 1.0f) < 1e-3f);
+    assert(fabs(min_xs[1] + 3.0f) < 1e-3f);
+
+    // separable data, classified by the sign of x0 - x1
+    rng::set_seed(13);
+    auto& generator = rng::thread_generator();
+    std::vector<std::vector<float>> xs;
+    std::vector<float> ys;
+    for(int i=0; i<64; i++)
+    {
+        auto x0 = generator.uniform(-1.0f, 1.0f);
+        auto x1 = generator.uniform(-1.0f, 1.0f);
+        xs.push_back({x0, x1});
+        ys.push_back(x0 > x1 ? 1.0f : 0.0f);
+    }
+    auto coeffs = numeric::logistic_regression(xs, ys);
+    auto correct = 0;
+    for(int i=0; i<xs.size(); i++)
+    {
+        auto h = coeffs[0] * xs[i][0] + coeffs[1] * xs[i][1] + coeffs[2];
+        correct += (h > 0) == (ys[i] == 1.0f);
+    }
+    std::cout << "logistic regression, correctly classified : " << correct << " / " << xs.size() << std::endl;
+    assert(correct >= 60);
+}
+
+int main()
+{
+    test_dual_001();
+    test_dual_002();
+    test_dual_003();
+}
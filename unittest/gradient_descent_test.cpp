@@ -1,8 +1,14 @@
 
 #include "../gradient_descent.hpp"
+#include "../linear_regression.hpp"
 
+#include <algorithm>
+#include <assert.h>
+#include <atomic>
+#include <chrono>
 #include <iostream>
 #include <math.h>
+#include <thread>
 
 /*
  * find min of cos(x)
@@ -42,6 +48,212 @@ void test_gradient_descent_002()
     std::cout << std::endl;
 }
 
+/*
+ * finite difference gradients: central and forward differences, serial and on the thread pool
+ */
+void test_gradient_descent_003()
+{
+
+    // f(xs) = sum_i (xs[i] - i)^2
+    std::atomic<int> evaluations(0);
+    std::function<float(std::vector<float>)> f = [&evaluations](std::vector<float> xs)
+    {
+        evaluations++;
+        auto y = 0.0f;
+        for(int i=0; i<xs.size(); i++)
+        {
+            y += (xs[i] - i) * (xs[i] - i);
+        }
+        return y;
+    };
+    std::vector<float> xs;
+    for(int i=0; i<32; i++)
+    {
+        xs.push_back(i + (i % 2 ? 0.5f : -0.25f));
+    }
+    auto y = f(xs);
+
+    // central differences take 2 evaluations per variable, forward differences reuse f(xs) and take 1
+    std::vector<float> central, forward, parallel_central;
+    evaluations = 0;
+    numeric::finite_difference_gradient(f, 1e-2f)(xs, y, central);
+    assert(evaluations == 2 * xs.size());
+    evaluations = 0;
+    numeric::finite_difference_gradient(f, 1e-2f, numeric::Differences::forward)(xs, y, forward);
+    assert(evaluations == xs.size());
+    parallel::set_number_of_threads(4);
+    numeric::finite_difference_gradient(f, 1e-2f, numeric::Differences::central, true)(xs, y, parallel_central);
+    parallel::set_number_of_threads(std::max(1u, std::thread::hardware_concurrency()));
+    for(int i=0; i<xs.size(); i++)
+    {
+        auto exact = 2.0f * (xs[i] - i);
+        assert(fabs(central[i] - exact) < 1e-2f * (1.0f + fabs(exact)));
+        assert(fabs(forward[i] - exact) < 2e-2f * (1.0f + fabs(exact)));
+        assert(parallel_central[i] == central[i]);
+    }
+
+    // gradient descent with parallel forward differences
+    auto min_xs = numeric::gradient_descent(f, xs, numeric::constant_learning_rate(0.25f), 64, true, true, numeric::Differences::forward, true);
+    auto err = 0.0f;
+    for(int i=0; i<xs.size(); i++)
+    {
+        err = std::max(err, fabsf(min_xs[i] - i));
+    }
+    std::cout << "min sum_i (x_i - i)^2 with parallel forward differences, max error : " << err << std::endl;
+    assert(err < 1e-2f);
+}
+
+/*
+ * gradient descent and linear regression take any callable: the results match those of the std::function wrappers
+ */
+void test_gradient_descent_004()
+{
+    auto f = [](const std::vector<float>& xs)
+    {
+        return (xs[0] - 1.0f) * (xs[0] - 1.0f) + 3.0f * (xs[1] + 2.0f) * (xs[1] + 2.0f);
+    };
+    std::function<float(std::vector<float>)> std_f = f;
+    auto min_xs = numeric::gradient_descent(f, {0.0f, 0.0f}, numeric::constant_learning_rate(0.1f), 200);
+    auto std_min_xs = numeric::gradient_descent(std_f, {0.0f, 0.0f}, numeric::constant_learning_rate(0.1f), 200);
+    assert(min_xs == std_min_xs);
+    assert(fabs(min_xs[0] - 1.0f) < 1e-3f && fabs(min_xs[1] + 2.0f) < 1e-3f);
+
+    // y = 2 x0 - x1 + 0.5
+    std::vector<std::vector<float>> xs;
+    std::vector<float> ys;
+    for(int i=0; i<256; i++)
+    {
+        auto x0 = (i % 16) / 8.0f - 1.0f;
+        auto x1 = (i / 16) / 8.0f - 1.0f;
+        xs.push_back({x0, x1});
+        ys.push_back(2.0f * x0 - x1 + 0.5f);
+    }
+    auto pred_function = [](const std::vector<float>& params, matrix::Span<const float> xs)
+    {
+        return params[0] * xs[0] + params[1] * xs[1] + params[2];
+    };
+    auto loss_function = [](matrix::Span<const float> ys, const std::vector<float>& pred_ys)
+    {
+        auto loss = 0.0f;
+        for(int i=0; i<ys.size(); i++)
+        {
+            loss += (pred_ys[i] - ys[i]) * (pred_ys[i] - ys[i]);
+        }
+        return loss / ys.size();
+    };
+    std::function<float(std::vector<float>, std::vector<float>)> std_pred_function = [](std::vector<float> params, std::vector<float> xs)
+    {
+        return params[0] * xs[0] + params[1] * xs[1] + params[2];
+    };
+    std::function<float(std::vector<float>, std::vector<float>)> std_loss_function = [](std::vector<float> ys, std::vector<float> pred_ys)
+    {
+        auto loss = 0.0f;
+        for(int i=0; i<ys.size(); i++)
+        {
+            loss += (pred_ys[i] - ys[i]) * (pred_ys[i] - ys[i]);
+        }
+        return loss / ys.size();
+    };
+    auto start = std::chrono::steady_clock::now();
+    auto params = numeric::linear_regression(xs, ys, pred_function, {0.0f, 0.0f, 0.0f}, loss_function, numeric::constant_learning_rate(0.2f), 512);
+    auto middle = std::chrono::steady_clock::now();
+    auto std_params = numeric::linear_regression(xs, ys, std_pred_function, {0.0f, 0.0f, 0.0f}, std_loss_function, numeric::constant_learning_rate(0.2f), 512);
+    auto stop = std::chrono::steady_clock::now();
+    std::cout << std::endl;
+    std::cout << "linear regression with inlined callables : " << std::chrono::duration<double, std::milli>(middle - start).count() << " ms, with std::function : "
+              << std::chrono::duration<double, std::milli>(stop - middle).count() << " ms" << std::endl;
+    assert(fabs(params[0] - 2.0f) < 1e-2f && fabs(params[1] + 1.0f) < 1e-2f && fabs(params[2] - 0.5f) < 1e-2f);
+    for(int i=0; i<params.size(); i++)
+    {
+        assert(fabs(params[i] - std_params[i]) < 1e-5f);
+    }
+}
+
+/*
+ * multi-start gradient descent escapes the local minimum a single run lands in, and cancels losing runs
+ */
+void test_gradient_descent_005()
+{
+    // rastrigin function: many local minima, global minimum 0 at the origin
+    std::atomic<int> evaluations(0);
+    auto f = [&evaluations](const std::vector<float>& xs)
+    {
+        evaluations++;
+        auto y = 10.0f * xs.size();
+        for(auto x : xs)
+        {
+            y += x * x - 10.0f * cosf(2.0f * M_PI * x);
+        }
+        return y;
+    };
+    auto lrs = numeric::constant_learning_rate(0.002f);
+    auto single_xs = numeric::gradient_descent(f, {3.1f, -2.2f}, lrs, 500);
+
+    rng::set_seed(19);
+    evaluations = 0;
+    auto multi_xs = numeric::multi_start_gradient_descent(f, {3.1f, -2.2f}, 3.0f, 64, lrs, 500);
+    auto cancelled_evaluations = evaluations.load();
+    rng::set_seed(19);
+    evaluations = 0;
+    auto all_xs = numeric::multi_start_gradient_descent(f, {3.1f, -2.2f}, 3.0f, 64, lrs, 500, std::numeric_limits<float>::infinity());
+    auto all_evaluations = evaluations.load();
+
+    std::cout << std::endl;
+    std::cout << "rastrigin, single start : " << f(single_xs) << ", 64 starts : " << f(multi_xs) << " (" << cancelled_evaluations
+              << " evaluations, " << all_evaluations << " without cancellation, best : " << f(all_xs) << ")" << std::endl;
+    assert(f(single_xs) > 5.0f);
+    assert(f(multi_xs) < 1.5f);
+    assert(f(multi_xs) < f(single_xs));
+    assert(cancelled_evaluations < all_evaluations / 2);
+}
+
+/*
+ * simultaneous perturbation (SPSA) gradient estimates cost 2 evaluations per iteration in any dimension,
+ * and keep working on a noisy loss where finite differences break down
+ */
+void test_gradient_descent_006()
+{
+    // sum_i (1 + i % 4) (x_i - 1)^2, plus noise of up to 0.01
+    std::atomic<int> evaluations(0);
+    auto noise = 0.0f;
+    auto f = [&evaluations, &noise](const std::vector<float>& xs)
+    {
+        evaluations++;
+        auto y = 0.0f;
+        for(int i=0; i<xs.size(); i++)
+        {
+            y += (1.0f + i % 4) * (xs[i] - 1.0f) * (xs[i] - 1.0f);
+        }
+        return y + noise * rng::thread_generator().uniform(-1.0f, 1.0f);
+    };
+
+    // 1 evaluation for the value, 2 for the estimate
+    rng::set_seed(21);
+    for(int n : {10, 200})
+    {
+        evaluations = 0;
+        numeric::gradient_descent(f, std::vector<float>(n, 0.0f), numeric::spsa_learning_rate(0.05f, 100.0f), 100, true, true,
+                                  numeric::Differences::simultaneous_perturbation);
+        assert(evaluations == 1 + 3 * 100);
+    }
+
+    // 200 variables, noisy
+    noise = 0.01f;
+    std::vector<float> initial_xs(200, 0.0f);
+    auto start_y = f(initial_xs);
+    evaluations = 0;
+    auto spsa_xs = numeric::gradient_descent(f, numeric::spsa_gradient(f, 0.1f), initial_xs, numeric::spsa_learning_rate(0.05f, 100.0f), 3000);
+    auto spsa_evaluations = evaluations.load();
+    evaluations = 0;
+    auto fd_xs = numeric::gradient_descent(f, initial_xs, numeric::constant_learning_rate(0.05f), spsa_evaluations / (2 * 200 + 1));
+    auto fd_evaluations = evaluations.load();
+    std::cout << std::endl;
+    std::cout << "noisy quadratic in 200 dimensions, from " << start_y << " to " << f(spsa_xs) << " with spsa (" << spsa_evaluations
+              << " evaluations), to " << f(fd_xs) << " with central differences (" << fd_evaluations << " evaluations)" << std::endl;
+    assert(f(spsa_xs) < 0.01f * start_y);
+    assert(f(fd_xs) > 0.5f * start_y);
+}
+
 /*
  * main
  */
@@ -49,4 +261,8 @@ int main()
 {
     test_gradient_descent_001();
     test_gradient_descent_002();
+    test_gradient_descent_003();
+    test_gradient_descent_004();
+    test_gradient_descent_005();
+    test_gradient_descent_006();
 }
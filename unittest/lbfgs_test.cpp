@@ -0,0 +1,137 @@
+#include "../dual.hpp"
+#include "../gradient_descent.hpp"
+#include "../lbfgs.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <iostream>
+#include <math.h>
+#include <vector>
+
+/*
+ * minimize the Rosenbrock function (a curved, narrow valley) in a few dimensions
+ */
+void test_lbfgs_001()
+{
+    auto rosenbrock = [](const auto& xs)
+    {
+        auto y = 0.0f * xs[0];
+        for(int i=0; i+1<xs.size(); i++)
+        {
+            y += 100.0f * (xs[i + 1] - xs[i] * xs[i]) * (xs[i + 1] - xs[i] * xs[i]) + (1.0f - xs[i]) * (1.0f - xs[i]);
+        }
+        return y;
+    };
+    auto evaluations = 0;
+    std::function<float(std::vector<float>)> f = [&rosenbrock, &evaluations](std::vector<float> xs)
+    {
+        evaluations++;
+        return rosenbrock(xs);
+    };
+    numeric::GradientFunction gradient = [&rosenbrock](const std::vector<float>& xs, float y, std::vector<float>& ds)
+    {
+        autodiff::gradient(rosenbrock, xs, ds);
+    };
+    std::cout << std::endl;
+    for(int n : {2, 5, 10})
+    {
+        evaluations = 0;
+        auto xs = numeric::lbfgs(f, gradient, std::vector<float>(n, -1.0f), 500);
+        auto err = 0.0f;
+        for(int i=0; i<n; i++)
+        {
+            err = std::max(err, fabsf(xs[i] - 1.0f));
+        }
+        std::cout << "rosenbrock in " << n << " dimensions, " << evaluations << " evaluations, max error : " << err << std::endl;
+        assert(err < 1e-2f);
+    }
+}
+
+/*
+ * an ill-conditioned quadratic: l-bfgs needs tens of iterations where gradient descent needs thousands,
+ * and the strong Wolfe conditions hold for the accepted step
+ */
+void test_lbfgs_002()
+{
+    // f(xs) = sum_i 10^(i / 2) (xs[i] - 1)^2
+    auto quadratic = [](const auto& xs)
+    {
+        auto y = 0.0f * xs[0];
+        for(int i=0; i<xs.size(); i++)
+        {
+            y += powf(10.0f, i / 2.0f) * (xs[i] - 1.0f) * (xs[i] - 1.0f);
+        }
+        return y;
+    };
+    std::function<float(std::vector<float>)> f = [&quadratic](std::vector<float> xs)
+    {
+        return quadratic(xs);
+    };
+    numeric::GradientFunction gradient = [&quadratic](const std::vector<float>& xs, float y, std::vector<float>& ds)
+    {
+        autodiff::gradient(quadratic, xs, ds);
+    };
+
+    // iterations until every coordinate is within 1e-3 of the minimum
+    auto at_minimum = [](const std::vector<float>& xs)
+    {
+        return std::all_of(xs.begin(), xs.end(), [](float x)
+        {
+            return fabs(x - 1.0f) < 1e-3f;
+        });
+    };
+    auto lbfgs_iterations = 0;
+    for(int k=1; k<100; k++)
+    {
+        auto xs = numeric::lbfgs(f, gradient, std::vector<float>(6, 0.0f), k);
+        if(at_minimum(xs))
+        {
+            lbfgs_iterations = k;
+            break;
+        }
+    }
+    auto gradient_descent_iterations = 0;
+    for(int k=1; k<100000; k*=2)
+    {
+        auto xs = numeric::gradient_descent(f, gradient, std::vector<float>(6, 0.0f), numeric::constant_learning_rate(0.0015f), k);
+        if(at_minimum(xs))
+        {
+            gradient_descent_iterations = k;
+            break;
+        }
+    }
+    std::cout << std::endl;
+    std::cout << "ill-conditioned quadratic, l-bfgs iterations : " << lbfgs_iterations << ", gradient descent iterations : " << gradient_descent_iterations << std::endl;
+    assert(lbfgs_iterations > 0 && lbfgs_iterations < 50);
+    assert(gradient_descent_iterations > 10 * lbfgs_iterations);
+
+    // a single line search along the negative gradient
+    numeric::LinePoint start;
+    start.alpha = 0.0f;
+    start.xs = std::vector<float>(6, 0.0f);
+    start.y = f(start.xs);
+    gradient(start.xs, start.y, start.ds);
+    std::vector<float> direction;
+    for(auto d : start.ds)
+    {
+        direction.push_back(-d);
+    }
+    start.slope = numeric::dot(start.ds, direction);
+    numeric::LinePoint out;
+    assert(numeric::wolfe_line_search(f, gradient, start, direction, out));
+    assert(out.y <= start.y + 1e-4f * out.alpha * start.slope);
+    assert(fabs(out.slope) <= 0.9f * fabs(start.slope));
+
+    // finite differences work too
+    auto xs = numeric::lbfgs(f, std::vector<float>(6, 0.0f));
+    for(auto x : xs)
+    {
+        assert(fabs(x - 1.0f) < 1e-2f);
+    }
+}
+
+int main()
+{
+    test_lbfgs_001();
+    test_lbfgs_002();
+}
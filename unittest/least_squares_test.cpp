@@ -0,0 +1,180 @@
+#include "../least_squares.hpp"
+#include "../linear_regression.hpp"
+#include "../polynomial_regression.hpp"
+
+#include <assert.h>
+#include <chrono>
+#include <iostream>
+#include <math.h>
+#include <vector>
+
+/*
+ * qr and cholesky solve consistent, rank deficient and ridge regularized problems
+ */
+void test_least_squares_001()
+{
+    // y = 3 - 2 x + 0.5 x^2, exactly
+    matrix::BasicMatrix<float> X(30, 3);
+    std::vector<float> ys;
+    for(int i=0; i<30; i++)
+    {
+        float x = i / 10.0f - 1.0f;
+        X(i, 0) = 1.0f;
+        X(i, 1) = x;
+        X(i, 2) = x * x;
+        ys.push_back(3.0f - 2.0f * x + 0.5f * x * x);
+    }
+    for(auto method : {numeric::LeastSquaresMethod::qr, numeric::LeastSquaresMethod::cholesky})
+    {
+        auto c = numeric::least_squares(X, ys, method);
+        assert(fabs(c[0] - 3.0f) < 1e-4f && fabs(c[1] + 2.0f) < 1e-4f && fabs(c[2] - 0.5f) < 1e-4f);
+    }
+
+    // a duplicated column: qr still fits the data (putting the weight on one of the two columns),
+    // cholesky falls back to qr
+    matrix::BasicMatrix<float> D(30, 4);
+    for(int i=0; i<30; i++)
+    {
+        for(int j=0; j<3; j++)
+        {
+            D(i, j) = X(i, j);
+        }
+        D(i, 3) = X(i, 1);
+    }
+    for(auto method : {numeric::LeastSquaresMethod::qr, numeric::LeastSquaresMethod::cholesky})
+    {
+        auto c = numeric::least_squares(D, ys, method);
+        assert(fabs(c[0] - 3.0f) < 1e-4f && fabs(c[1] + c[3] + 2.0f) < 1e-4f && fabs(c[2] - 0.5f) < 1e-4f);
+        assert(c[1] == 0.0f || c[3] == 0.0f);
+    }
+
+    // ridge: both methods agree, and the coefficients shrink
+    auto qr = numeric::least_squares(X, ys, numeric::LeastSquaresMethod::qr, 2.0f);
+    auto cholesky = numeric::least_squares(X, ys, numeric::LeastSquaresMethod::cholesky, 2.0f);
+    auto norm = 0.0f;
+    for(int j=0; j<3; j++)
+    {
+        assert(fabs(qr[j] - cholesky[j]) < 1e-4f);
+        norm += qr[j] * qr[j];
+    }
+    assert(norm < 3.0f * 3.0f + 2.0f * 2.0f + 0.5f * 0.5f);
+}
+
+/*
+ * linear regression solves linear models with a squared error directly, and falls back to gradient descent otherwise;
+ * polynomial regression is fast
+ */
+void test_least_squares_002()
+{
+    // y = 2 x0 - x1 + 0.5
+    std::vector<std::vector<float>> xs;
+    std::vector<float> ys;
+    for(int i=0; i<64; i++)
+    {
+        auto x0 = (i % 8) / 4.0f - 1.0f;
+        auto x1 = (i / 8) / 4.0f - 1.0f;
+        xs.push_back({x0, x1});
+        ys.push_back(2.0f * x0 - x1 + 0.5f);
+    }
+    auto linear = [](const std::vector<float>& params, matrix::Span<const float> xs)
+    {
+        return params[0] * xs[0] + params[1] * xs[1] + params[2];
+    };
+    auto sigmoid = [](const std::vector<float>& params, matrix::Span<const float> xs)
+    {
+        return 1.0f / (1.0f + expf(-(params[0] * xs[0] + params[1] * xs[1] + params[2])));
+    };
+    auto mse = [](matrix::Span<const float> ys, const std::vector<float>& pred_ys)
+    {
+        return matrix::squared_norm(matrix::as_row(pred_ys) - matrix::as_row(ys)) / ys.size();
+    };
+    auto mae = [](matrix::Span<const float> ys, const std::vector<float>& pred_ys)
+    {
+        return matrix::norm1(matrix::as_row(pred_ys) - matrix::as_row(ys)) / ys.size();
+    };
+
+    // the checks behind the automatic solver
+    std::vector<float> flat_xs;
+    for(auto& x : xs)
+    {
+        flat_xs.insert(flat_xs.end(), x.begin(), x.end());
+    }
+    matrix::BasicMatrix<float> design;
+    std::vector<float> offsets;
+    assert(numeric::linear_design(linear, flat_xs, 2, 3, design, offsets));
+    assert(!numeric::linear_design(sigmoid, flat_xs, 2, 3, design, offsets));
+    assert(numeric::squared_error(mse, ys));
+    assert(!numeric::squared_error(mae, ys));
+
+    auto params = numeric::linear_regression(xs, ys, linear, {0.0f, 0.0f, 0.0f}, mse, numeric::constant_learning_rate(0.1f), 1, -1, numeric::Solver::automatic);
+    assert(fabs(params[0] - 2.0f) < 1e-4f && fabs(params[1] + 1.0f) < 1e-4f && fabs(params[2] - 0.5f) < 1e-4f);
+    params = numeric::linear_regression(xs, ys, linear, {0.0f, 0.0f, 0.0f}, mae, numeric::constant_learning_rate(0.1f), 1, -1, numeric::Solver::automatic);
+    assert(fabs(params[0] - 2.0f) > 1e-1f);
+
+    // many small polynomial fits
+    auto start = std::chrono::steady_clock::now();
+    auto max_err = 0.0f;
+    for(int k=0; k<1000; k++)
+    {
+        std::vector<float> poly_xs;
+        std::vector<float> poly_ys;
+        for(int i=0; i<20; i++)
+        {
+            float x = i / 4.0f;
+            poly_xs.push_back(x);
+            poly_ys.push_back(0.25f + 0.001f * k - 1.5f * x + 0.75f * x * x);
+        }
+        auto coeffs = numeric::polynomial_regression(poly_xs, poly_ys, 2);
+        max_err = std::max({max_err, fabsf(coeffs[0] - 0.25f - 0.001f * k), fabsf(coeffs[1] + 1.5f), fabsf(coeffs[2] - 0.75f)});
+    }
+    auto stop = std::chrono::steady_clock::now();
+    std::cout << std::endl;
+    std::cout << "1000 quadratic fits : " << std::chrono::duration<double, std::milli>(stop - start).count() << " ms, max coefficient error : " << max_err << std::endl;
+    assert(max_err < 1e-3f);
+}
+
+/*
+ * the least squares options of a regression fit: cholesky agrees with qr, and ridge shrinks the coefficients
+ */
+void test_least_squares_003()
+{
+    std::vector<float> xs;
+    std::vector<float> ys;
+    for(int i=0; i<20; i++)
+    {
+        float x = i / 4.0f - 2.5f;
+        xs.push_back(x);
+        ys.push_back(0.25f - 1.5f * x + 0.75f * x * x);
+    }
+    auto squared_norm = [](const std::vector<float>& coeffs)
+    {
+        auto sum = 0.0f;
+        for(auto c : coeffs)
+        {
+            sum += c * c;
+        }
+        return sum;
+    };
+
+    auto qr = numeric::polynomial_regression(xs, ys, 2);
+    auto cholesky = numeric::polynomial_regression(xs, ys, 2, numeric::LeastSquaresMethod::cholesky);
+    auto ridge_qr = numeric::polynomial_regression(xs, ys, 2, numeric::LeastSquaresMethod::qr, 10.0f);
+    auto ridge_cholesky = numeric::polynomial_regression(xs, ys, 2, numeric::LeastSquaresMethod::cholesky, 10.0f);
+    std::cout << std::endl;
+    std::cout << "quadratic fit : " << qr[0] << ", " << qr[1] << ", " << qr[2]
+              << ", with ridge : " << ridge_qr[0] << ", " << ridge_qr[1] << ", " << ridge_qr[2] << std::endl;
+    for(int j=0; j<3; j++)
+    {
+        assert(fabs(qr[j] - cholesky[j]) < 1e-3f);
+        assert(fabs(ridge_qr[j] - ridge_cholesky[j]) < 1e-3f);
+    }
+    assert(fabs(qr[0] - 0.25f) < 1e-3f && fabs(qr[1] + 1.5f) < 1e-3f && fabs(qr[2] - 0.75f) < 1e-3f);
+    assert(squared_norm(ridge_qr) < 0.9f * squared_norm(qr));
+}
+
+int main()
+{
+    test_least_squares_001();
+    test_least_squares_002();
+    test_least_squares_003();
+}
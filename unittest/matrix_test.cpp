@@ -0,0 +1,322 @@
+#include "../gemm.hpp"
+#include "../matrix.hpp"
+#include "../reductions.hpp"
+#include "../thread_pool.hpp"
+
+#include <assert.h>
+#include <chrono>
+#include <iostream>
+#include <math.h>
+
+/*
+ * reference (naive) matrix multiplication
+ */
+matrix::FloatMatrix naive_mul(const matrix::FloatMatrix& a, const matrix::FloatMatrix& b)
+{
+    auto out = matrix::zero(matrix::rows(a), matrix::cols(b));
+    for(int i=0; i<matrix::rows(a); i++)
+    {
+        for(int j=0; j<matrix::cols(b); j++)
+        {
+            for(int k=0; k<matrix::cols(a); k++)
+            {
+                out[i][j] += a[i][k] * b[k][j];
+            }
+        }
+    }
+    return out;
+}
+
+float max_abs_difference(const matrix::FloatMatrix& a, const matrix::FloatMatrix& b)
+{
+    assert(matrix::rows(a) == matrix::rows(b));
+    assert(matrix::cols(a) == matrix::cols(b));
+    auto out = 0.0f;
+    for(int i=0; i<a.size(); i++)
+    {
+        auto d = fabs(a.data()[i] - b.data()[i]);
+        out = d > out ? d : out;
+    }
+    return out;
+}
+
+/*
+ * compare every available gemm kernel against the naive product, on sizes that exercise the edge tiles
+ */
+void test_matrix_mul_001()
+{
+    std::vector<std::vector<int>> sizes =
+    {
+        {1, 1, 1},
+        {3, 5, 7},
+        {33, 17, 65},
+        {100, 37, 259},
+        {97, 300, 513}
+    };
+    std::cout << std::endl;
+    for(auto& kern : matrix::gemm::available_kernels())
+    {
+        for(auto& mnk : sizes)
+        {
+            auto a = matrix::random(mnk[0], mnk[2]);
+            auto b = matrix::random(mnk[2], mnk[1]);
+            auto c = matrix::zero(mnk[0], mnk[1]);
+            matrix::gemm::sgemm(kern, false, false, mnk[0], mnk[1], mnk[2], a.data(), matrix::cols(a), b.data(), matrix::cols(b), c.data(), matrix::cols(c));
+            auto err = max_abs_difference(c, naive_mul(a, b));
+            std::cout << "gemm kernel " << kern.name << " " << mnk[0] << "x" << mnk[1] << "x" << mnk[2] << ", max error : " << err << std::endl;
+            assert(err < 1e-3f * mnk[2]);
+        }
+    }
+}
+
+/*
+ * time a 512 x 512 x 512 product
+ */
+void test_matrix_mul_002()
+{
+    auto a = matrix::random(512, 512);
+    auto b = matrix::random(512, 512);
+    auto start = std::chrono::steady_clock::now();
+    auto c = matrix::mul(a, b);
+    auto stop = std::chrono::steady_clock::now();
+    std::cout << std::endl;
+    std::cout << "mul 512x512x512 using " << matrix::gemm::kernel().name << " kernel : "
+              << std::chrono::duration<double, std::milli>(stop - start).count() << " ms" << std::endl;
+}
+
+/*
+ * multithreaded operations must produce the same results as serial ones
+ */
+void test_matrix_parallel_003()
+{
+    auto a = matrix::random(123, 77);
+    auto b = matrix::random(77, 301);
+    auto c = matrix::random(123, 77);
+    auto sigmoid = [](float x)
+    {
+        return 1.0f / (1.0f + exp(-x));
+    };
+
+    // serial
+    parallel::set_number_of_threads(1);
+    auto serial_mul = matrix::mul(a, b);
+    auto serial_add = matrix::add(a, c);
+    auto serial_f = matrix::apply_function(a, sigmoid);
+
+    // parallel, with a threshold low enough to split everything
+    parallel::set_number_of_threads(4);
+    parallel::set_serial_threshold(64);
+    auto parallel_mul = matrix::mul(a, b);
+    auto parallel_mul_wide = matrix::mul(matrix::slice_rows(a, 0, 3), b);
+    auto parallel_add = matrix::add(a, c);
+    auto parallel_f = matrix::apply_function(a, sigmoid);
+
+    std::cout << std::endl;
+    std::cout << "parallel mul, max difference : " << max_abs_difference(serial_mul, parallel_mul) << std::endl;
+    std::cout << "parallel add, max difference : " << max_abs_difference(serial_add, parallel_add) << std::endl;
+    std::cout << "parallel apply_function, max difference : " << max_abs_difference(serial_f, parallel_f) << std::endl;
+    assert(max_abs_difference(serial_mul, parallel_mul) < 1e-4f);
+    assert(max_abs_difference(matrix::slice_rows(serial_mul, 0, 3), parallel_mul_wide) < 1e-4f);
+    assert(max_abs_difference(serial_add, parallel_add) == 0.0f);
+    assert(max_abs_difference(serial_f, parallel_f) == 0.0f);
+
+    // restore defaults
+    parallel::set_number_of_threads(std::max(1u, std::thread::hardware_concurrency()));
+    parallel::set_serial_threshold(1 << 16);
+}
+
+/*
+ * fused expressions must match the equivalent chain of materialized operations
+ */
+void test_matrix_expression_004()
+{
+    auto a = matrix::random(31, 17);
+    auto b = matrix::random(31, 17);
+    auto c = matrix::random(31, 17);
+    auto d = matrix::random(31, 17);
+    auto s = 0.25f;
+
+    // a + s * (b - c) (.) d
+    matrix::FloatMatrix fused = a + s * (b - c) % d;
+    auto unfused = matrix::add(a, matrix::scalar(matrix::dotproduct(matrix::subtract(b, c), d), s));
+
+    // in-place update that refers to itself
+    auto w = a;
+    w += s * matrix::map(b, [](float x)
+    {
+        return x * (1.0f - x);
+    });
+    auto w_unfused = matrix::add(a, matrix::scalar(matrix::apply_function(b, [](float x)
+    {
+        return x * (1.0f - x);
+    }), s));
+
+    std::cout << std::endl;
+    std::cout << "fused expression, max difference : " << max_abs_difference(fused, unfused) << std::endl;
+    std::cout << "in-place expression, max difference : " << max_abs_difference(w, w_unfused) << std::endl;
+    assert(max_abs_difference(fused, unfused) < 1e-6f);
+    assert(max_abs_difference(w, w_unfused) < 1e-6f);
+}
+
+/*
+ * transpose-aware multiplication (NN, NT, TN, TT) must match multiplication of materialized transposes
+ */
+void test_matrix_mul_transposed_005()
+{
+    std::vector<std::vector<int>> sizes =
+    {
+        {1, 3, 2},
+        {7, 5, 3},
+        {100, 37, 259},
+        {97, 300, 65}
+    };
+    std::cout << std::endl;
+    for(auto& mnk : sizes)
+    {
+        auto a = matrix::random(mnk[0], mnk[2]);
+        auto b = matrix::random(mnk[2], mnk[1]);
+        auto expected = naive_mul(a, b);
+        auto a_t = matrix::transpose(a);
+        auto b_t = matrix::transpose(b);
+        auto err_nn = max_abs_difference(matrix::mul(a, b, false, false), expected);
+        auto err_nt = max_abs_difference(matrix::mul(a, b_t, false, true), expected);
+        auto err_tn = max_abs_difference(matrix::mul(a_t, b, true, false), expected);
+        auto err_tt = max_abs_difference(matrix::mul(a_t, b_t, true, true), expected);
+        std::cout << "transposed mul " << mnk[0] << "x" << mnk[1] << "x" << mnk[2] << ", max error NN/NT/TN/TT : "
+                  << err_nn << " " << err_nt << " " << err_tn << " " << err_tt << std::endl;
+        assert(err_nn < 1e-3f * mnk[2]);
+        assert(err_nt < 1e-3f * mnk[2]);
+        assert(err_tn < 1e-3f * mnk[2]);
+        assert(err_tt < 1e-3f * mnk[2]);
+    }
+
+    // split over threads, by rows (tall output) and by columns (wide output)
+    parallel::set_number_of_threads(4);
+    parallel::set_serial_threshold(64);
+    auto a = matrix::random(300, 40);
+    auto b = matrix::random(3, 40);
+    auto err_tall = max_abs_difference(matrix::mul(a, b, false, true), naive_mul(a, matrix::transpose(b)));
+    auto err_wide = max_abs_difference(matrix::mul(b, a, false, true), naive_mul(b, matrix::transpose(a)));
+    std::cout << "parallel transposed mul, max error tall/wide : " << err_tall << " " << err_wide << std::endl;
+    assert(err_tall < 1e-3f * 40);
+    assert(err_wide < 1e-3f * 40);
+    parallel::set_number_of_threads(std::max(1u, std::thread::hardware_concurrency()));
+    parallel::set_serial_threshold(1 << 16);
+}
+
+/*
+ * double matrices multiply in double precision, half-width matrices store rounded elements but accumulate in float
+ */
+void test_matrix_precision_006()
+{
+    // conversions
+    assert((float) matrix::bfloat16(1.0f) == 1.0f);
+    assert((float) matrix::float16(-2.5f) == -2.5f);
+    assert((float) matrix::float16(65504.0f) == 65504.0f);
+    assert(isinf((float) matrix::float16(1e5f)));
+    assert(fabs((float) matrix::float16(1e-6f) - 1e-6f) < 6e-8f);
+    assert(fabs((float) matrix::bfloat16(3.14159f) - 3.14159f) < 3.14159f / 128);
+
+    auto a = matrix::random(97, 300);
+    auto b = matrix::random(300, 65);
+    auto expected = naive_mul(a, b);
+
+    auto d = matrix::mul(matrix::cast<double>(a), matrix::cast<double>(b));
+    auto err_double = max_abs_difference(matrix::cast<float>(d), expected);
+
+    // the reference for half-width products uses the rounded operands, so only accumulation errors remain
+    auto a_bf16 = matrix::cast<matrix::bfloat16>(a);
+    auto b_bf16 = matrix::cast<matrix::bfloat16>(b);
+    auto err_bf16 = max_abs_difference(matrix::cast<float>(matrix::mul(a_bf16, b_bf16)), naive_mul(matrix::cast<float>(a_bf16), matrix::cast<float>(b_bf16)));
+    auto a_f16 = matrix::cast<matrix::float16>(matrix::transpose(a));
+    auto b_f16 = matrix::cast<matrix::float16>(b);
+    auto err_f16 = max_abs_difference(matrix::cast<float>(matrix::mul(a_f16, b_f16, true, false)),
+                                      naive_mul(matrix::transpose(matrix::cast<float>(a_f16)), matrix::cast<float>(b_f16)));
+
+    std::cout << std::endl;
+    std::cout << "double mul, max error : " << err_double << std::endl;
+    std::cout << "bfloat16 mul, max error (relative to result) : " << err_bf16 / matrix::max(expected) << std::endl;
+    std::cout << "float16 mul, max error (relative to result) : " << err_f16 / matrix::max(expected) << std::endl;
+    assert(err_double < 1e-3f);
+    assert(err_bf16 < matrix::max(expected) / 128);
+    assert(err_f16 < matrix::max(expected) / 1024);
+}
+
+/*
+ * sparse products (all transpose forms) must match the dense products of the same matrices
+ */
+void test_matrix_sparse_007()
+{
+    // about 5% non-zeros
+    auto a = matrix::random(120, 90);
+    for(int i=0; i<a.size(); i++)
+    {
+        a.data()[i] = a.data()[i] < 0.05f ? a.data()[i] * 20.0f : 0.0f;
+    }
+    matrix::SparseMatrix s(a);
+    auto b = matrix::random(90, 33);
+    auto c = matrix::random(120, 33);
+    auto b_t = matrix::transpose(b);
+    auto c_t = matrix::transpose(c);
+
+    auto err_nn = max_abs_difference(matrix::mul(s, b), matrix::mul(a, b));
+    auto err_nt = max_abs_difference(matrix::mul(s, b_t, false, true), matrix::mul(a, b));
+    auto err_tn = max_abs_difference(matrix::mul(s, c, true, false), matrix::mul(a, c, true, false));
+    auto err_tt = max_abs_difference(matrix::mul(s, c_t, true, true), matrix::mul(a, c, true, false));
+    auto err_dense_nn = max_abs_difference(matrix::mul(c_t, s), matrix::mul(c_t, a));
+    auto err_dense_tn = max_abs_difference(matrix::mul(c, s, true, false), matrix::mul(c, a, true, false));
+    auto err_dense_nt = max_abs_difference(matrix::mul(b_t, s, false, true), matrix::mul(b_t, a, false, true));
+
+    // structure
+    auto t = matrix::transpose(s);
+    auto slice = matrix::SparseMatrix();
+    matrix::slice_rows(s, 10, 50, slice);
+    matrix::SparseMatrix coo(2, 3, {{1, 2, 1.0f}, {0, 0, 2.0f}, {1, 2, 0.5f}});
+
+    std::cout << std::endl;
+    std::cout << "sparse mul (" << s.non_zeros() << " non-zeros), max error NN/NT/TN/TT : "
+              << err_nn << " " << err_nt << " " << err_tn << " " << err_tt << std::endl;
+    std::cout << "dense x sparse mul, max error NN/TN/NT : " << err_dense_nn << " " << err_dense_tn << " " << err_dense_nt << std::endl;
+    assert(err_nn < 1e-4f && err_nt < 1e-4f && err_tn < 1e-4f && err_tt < 1e-4f);
+    assert(err_dense_nn < 1e-4f && err_dense_tn < 1e-4f && err_dense_nt < 1e-4f);
+    assert(max_abs_difference(matrix::dense(t), matrix::transpose(a)) == 0.0f);
+    assert(max_abs_difference(matrix::dense(slice), matrix::slice_rows(a, 10, 50)) == 0.0f);
+    assert(coo.non_zeros() == 2);
+    assert(max_abs_difference(matrix::dense(coo), {{2.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.5f}}) == 0.0f);
+}
+
+/*
+ * unrolled fixed-size products and functions must match their dynamic counterparts
+ */
+void test_matrix_fixed_008()
+{
+    auto a = matrix::random(3, 7);
+    auto b = matrix::random(7, 5);
+    matrix::FixedMatrix<3, 7> a_fixed(a);
+    matrix::FixedMatrix<7, 5> b_fixed(b);
+    auto sigmoid = [](float x)
+    {
+        return 1.0f / (1.0f + exp(-x));
+    };
+    auto c = matrix::apply_function(matrix::mul(a_fixed, b_fixed), sigmoid);
+    auto err = max_abs_difference(matrix::dynamic(c), matrix::apply_function(naive_mul(a, b), sigmoid));
+    matrix::FixedMatrix<2, 2> m = {{1.0f, 2.0f}, {3.0f, 4.0f}};
+    auto m2 = matrix::mul(m, m);
+
+    std::cout << std::endl;
+    std::cout << "fixed mul, max error : " << err << std::endl;
+    assert(err < 1e-6f);
+    assert(m2(0, 0) == 7.0f && m2(0, 1) == 10.0f && m2(1, 0) == 15.0f && m2(1, 1) == 22.0f);
+}
+
+int main()
+{
+    test_matrix_mul_001();
+    test_matrix_mul_002();
+    test_matrix_parallel_003();
+    test_matrix_expression_004();
+    test_matrix_mul_transposed_005();
+    test_matrix_precision_006();
+    test_matrix_sparse_007();
+    test_matrix_fixed_008();
+}
@@ -0,0 +1,112 @@
+#include "../linear_regression.hpp"
+#include "../minibatch.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <iostream>
+#include <math.h>
+#include <vector>
+
+/*
+ * every epoch visits every datapoint once, in a new order; the last batch is kept, dropped or wrapped
+ */
+void test_minibatch_001()
+{
+    rng::set_seed(23);
+    numeric::MiniBatches partial(10, 4);
+    assert(partial.batches_per_epoch() == 3);
+    std::vector<std::vector<int>> epochs(2);
+    for(int step=0; step<6; step++)
+    {
+        auto batch = partial.batch(step);
+        assert(batch.size() == (step % 3 == 2 ? 2 : 4));
+        epochs[partial.epoch(step)].insert(epochs[partial.epoch(step)].end(), batch.begin(), batch.end());
+    }
+    assert(epochs[0] != epochs[1]);
+    for(auto& epoch : epochs)
+    {
+        std::sort(epoch.begin(), epoch.end());
+        for(int i=0; i<10; i++)
+        {
+            assert(epoch[i] == i);
+        }
+    }
+
+    numeric::MiniBatches drop(10, 4, true, numeric::LastBatch::drop);
+    assert(drop.batches_per_epoch() == 2);
+    assert(drop.batch(0).size() == 4 && drop.batch(1).size() == 4 && drop.epoch(2) == 1);
+
+    numeric::MiniBatches wrap(10, 4, false, numeric::LastBatch::wrap);
+    assert(wrap.batches_per_epoch() == 3);
+    auto last = wrap.batch(2);
+    assert(last.size() == 4);
+    assert(last[0] == 8 && last[1] == 9 && last[2] == 0 && last[3] == 1);
+
+    // same seed, same batches
+    rng::set_seed(23);
+    numeric::MiniBatches again(10, 4);
+    std::vector<int> first_epoch;
+    for(int step=0; step<3; step++)
+    {
+        auto batch = again.batch(step);
+        first_epoch.insert(first_epoch.end(), batch.begin(), batch.end());
+    }
+    rng::set_seed(23);
+    numeric::MiniBatches once_more(10, 4);
+    for(int step=0; step<3; step++)
+    {
+        auto batch = once_more.batch(step);
+        assert(std::equal(batch.begin(), batch.end(), first_epoch.begin() + 4 * step));
+    }
+}
+
+/*
+ * a mini-batch step of linear regression costs O(batch size) predictions instead of O(n)
+ */
+void test_minibatch_002()
+{
+    // y = 2 x0 - x1 + 0.5
+    rng::set_seed(23);
+    auto& generator = rng::thread_generator();
+    std::vector<std::vector<float>> xs;
+    std::vector<float> ys;
+    for(int i=0; i<4096; i++)
+    {
+        auto x0 = generator.uniform(-1.0f, 1.0f);
+        auto x1 = generator.uniform(-1.0f, 1.0f);
+        xs.push_back({x0, x1});
+        ys.push_back(2.0f * x0 - x1 + 0.5f);
+    }
+    auto predictions = 0L;
+    auto pred_function = [&predictions](const auto& params, matrix::Span<const float> xs)
+    {
+        predictions++;
+        return params[0] * xs[0] + params[1] * xs[1] + params[2];
+    };
+    auto loss_function = [](matrix::Span<const float> ys, const auto& pred_ys)
+    {
+        auto loss = (pred_ys[0] - ys[0]) * (pred_ys[0] - ys[0]);
+        for(int i=1; i<ys.size(); i++)
+        {
+            loss += (pred_ys[i] - ys[i]) * (pred_ys[i] - ys[i]);
+        }
+        return loss / ys.size();
+    };
+
+    // 4 epochs of 128 batches of 32, with reverse-mode gradients (one prediction per datapoint of the batch)
+    auto params = numeric::linear_regression(autodiff::reverse_mode, xs, ys, pred_function, {0.0f, 0.0f, 0.0f}, loss_function,
+                  numeric::constant_learning_rate(0.2f), 512, 32);
+    std::cout << std::endl;
+    std::cout << "mini-batch linear regression : " << params[0] << ", " << params[1] << ", " << params[2] << " (" << predictions << " predictions)" << std::endl;
+    assert(fabs(params[0] - 2.0f) < 1e-2f && fabs(params[1] + 1.0f) < 1e-2f && fabs(params[2] - 0.5f) < 1e-2f);
+
+    // 512 batches of 32, plus the loss on all data at the start and after every epoch, plus the pretty coefficients search
+    // (at most 1 + 3 * 4 evaluations for 3 parameters)
+    assert(predictions <= 512 * 32 + 5 * 4096 + 13 * 4096);
+}
+
+int main()
+{
+    test_minibatch_001();
+    test_minibatch_002();
+}
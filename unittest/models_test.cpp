@@ -0,0 +1,168 @@
+#include "../dual.hpp"
+#include "../linear_regression.hpp"
+#include "../models.hpp"
+
+#include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <math.h>
+#include <vector>
+
+/*
+ * the built-in models predict a block of rows like they predict every row on its own, also for dual numbers
+ */
+void test_models_001()
+{
+    static_assert(numeric::is_batch_predictor<numeric::LinearModel, float>::value, "linear model predicts batches");
+    static_assert(numeric::is_batch_predictor<numeric::LogisticModel, autodiff::Dual<float, 8>>::value, "logistic model predicts batches of dual numbers");
+    static_assert(!numeric::is_batch_predictor<std::function<float(std::vector<float>, std::vector<float>)>, float>::value, "std::function predicts rows");
+
+    std::vector<float> xs;
+    for(int i=0; i<24; i++)
+    {
+        xs.push_back(0.25f * i - 1.5f);
+    }
+    auto check = [&xs](const auto& model, const std::vector<float>& params, int dims)
+    {
+        int rows = xs.size() / dims;
+        std::vector<float> ys(rows);
+        model.predict(params, matrix::Span<const float>(xs), dims, matrix::Span<float>(ys));
+        for(int i=0; i<rows; i++)
+        {
+            auto y = model(params, matrix::Span<const float>(xs.data() + i * dims, dims));
+            assert(fabs(ys[i] - y) <= 1e-6f * (1.0f + fabs(y)));
+        }
+
+        // the derivatives of the predictions, with respect to the first parameter
+        std::vector<autodiff::Dual<float, 8>> dual_params;
+        for(int j=0; j<params.size(); j++)
+        {
+            dual_params.push_back(autodiff::Dual<float, 8>(params[j]));
+        }
+        dual_params[0].d[0] = 1.0f;
+        std::vector<autodiff::Dual<float, 8>> dual_ys(rows);
+        model.predict(dual_params, matrix::Span<const float>(xs), dims, matrix::Span<autodiff::Dual<float, 8>>(dual_ys));
+        for(int i=0; i<rows; i++)
+        {
+            auto y = model(dual_params, matrix::Span<const float>(xs.data() + i * dims, dims));
+            assert(fabs(dual_ys[i].d[0] - y.d[0]) <= 1e-6f * (1.0f + fabs(y.d[0])));
+        }
+    };
+    check(numeric::LinearModel(), {0.5f, -1.0f, 2.0f, 0.25f}, 3);
+    check(numeric::LogisticModel(), {0.5f, -1.0f, 0.25f}, 2);
+    check(numeric::PolynomialModel(), {1.0f, -2.0f, 0.5f, 0.125f}, 1);
+    assert(numeric::PolynomialModel()(std::vector<float> {1.0f, -2.0f, 0.5f}, matrix::Span<const float>(xs.data(), 1)) == 1.0f + 3.0f + 0.5f * 2.25f);
+
+    // losses
+    std::vector<float> ys = {0.0f, 1.0f, 1.0f};
+    std::vector<float> pred_ys = {0.25f, 0.5f, 1.0f};
+    assert(fabs(numeric::MeanSquaredError()(matrix::Span<const float>(ys), pred_ys) - (0.0625f + 0.25f) / 3.0f) < 1e-7f);
+    auto cross_entropy = (-log(0.75f) - log(0.5f) - log(0.999f)) / 3.0f;
+    assert(fabs(numeric::CrossEntropy()(matrix::Span<const float>(ys), pred_ys) - cross_entropy) < 1e-6f);
+}
+
+/*
+ * fitting with the built-in model and loss gives the results of the equivalent std::functions, in a fraction of the time
+ */
+void test_models_002()
+{
+    // y = 2 x0 - x1 + 0.5
+    std::vector<std::vector<float>> xs;
+    std::vector<float> ys;
+    for(int i=0; i<4096; i++)
+    {
+        auto x0 = (i % 64) / 32.0f - 1.0f;
+        auto x1 = (i / 64) / 32.0f - 1.0f;
+        xs.push_back({x0, x1});
+        ys.push_back(2.0f * x0 - x1 + 0.5f);
+    }
+    std::function<float(std::vector<float>, std::vector<float>)> pred_function = [](std::vector<float> params, std::vector<float> xs)
+    {
+        return params[0] * xs[0] + params[1] * xs[1] + params[2];
+    };
+    std::function<float(std::vector<float>, std::vector<float>)> loss_function = [](std::vector<float> ys, std::vector<float> pred_ys)
+    {
+        auto loss = 0.0f;
+        for(int i=0; i<ys.size(); i++)
+        {
+            loss += (pred_ys[i] - ys[i]) * (pred_ys[i] - ys[i]);
+        }
+        return loss / ys.size();
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    auto params = numeric::linear_regression(xs, ys, numeric::LinearModel(), {0.0f, 0.0f, 0.0f}, numeric::MeanSquaredError(),
+                  numeric::constant_learning_rate(0.2f), 256);
+    auto middle = std::chrono::steady_clock::now();
+    auto std_params = numeric::linear_regression(xs, ys, pred_function, {0.0f, 0.0f, 0.0f}, loss_function, numeric::constant_learning_rate(0.2f), 256);
+    auto stop = std::chrono::steady_clock::now();
+    std::cout << std::endl;
+    std::cout << "linear regression on 4096 datapoints, built-in model and loss : " << std::chrono::duration<double, std::milli>(middle - start).count()
+              << " ms, std::function : " << std::chrono::duration<double, std::milli>(stop - middle).count() << " ms" << std::endl;
+    assert(fabs(params[0] - 2.0f) < 1e-2f && fabs(params[1] + 1.0f) < 1e-2f && fabs(params[2] - 0.5f) < 1e-2f);
+    for(int j=0; j<3; j++)
+    {
+        assert(fabs(params[j] - std_params[j]) < 1e-3f);
+    }
+}
+
+/*
+ * the pretty coefficients search rounds greedily, one parameter per round, within its budget of evaluations
+ */
+void test_models_003()
+{
+    // 12 parameters, near integers (3^12 candidates for an exhaustive search)
+    std::vector<float> targets;
+    std::vector<float> params;
+    for(int j=0; j<12; j++)
+    {
+        targets.push_back(j - 6.0f);
+        params.push_back(j - 6.0f + (j % 2 == 0 ? 0.3f : -0.2f));
+    }
+    std::atomic<int> evaluations(0);
+    auto f = [&targets, &evaluations](const std::vector<float>& params)
+    {
+        evaluations++;
+        auto loss = 0.0f;
+        for(int j=0; j<params.size(); j++)
+        {
+            loss += (params[j] - targets[j]) * (params[j] - targets[j]);
+        }
+        return loss;
+    };
+
+    // rounds all of them, in at most 1 + 2 (12 + 11 + .. + 1) evaluations (on the thread pool)
+    auto pretty = numeric::pretty_params_search(f, params, 256, true, 1L << 20);
+    std::cout << std::endl;
+    std::cout << "pretty coefficients search on 12 parameters : " << evaluations << " evaluations" << std::endl;
+    assert(pretty == targets);
+    assert(evaluations <= 1 + 12 * 13);
+
+    // the budget caps the number of evaluations
+    evaluations = 0;
+    pretty = numeric::pretty_params_search(f, params, 32);
+    assert(evaluations <= 32);
+    assert(f(pretty) < f(params));
+
+    // a budget of 0 disables it
+    evaluations = 0;
+    assert(numeric::pretty_params_search(f, params, 0) == params);
+    assert(evaluations == 0);
+
+    // rounding that makes f worse is not kept
+    for(auto& t : targets)
+    {
+        t += 0.5f;
+    }
+    evaluations = 0;
+    assert(numeric::pretty_params_search(f, targets, 256) == targets);
+    assert(evaluations == 1 + 2 * 12);
+}
+
+int main()
+{
+    test_models_001();
+    test_models_002();
+    test_models_003();
+}
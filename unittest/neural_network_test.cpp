@@ -2,7 +2,13 @@
 #include "../matrix.hpp"
 #include "../neural_network.hpp"
 
+#include <algorithm>
+#include <assert.h>
+#include <chrono>
 #include <iostream>
+#include <math.h>
+#include <string>
+#include <utility>
 #include <vector>
 
 void test_neural_network_001()
@@ -129,7 +135,116 @@ void test_neural_network_002()
 
 }
 
+/*
+ * networks of double and half-width weights train like float networks
+ */
+template<typename T>
+void test_neural_network_precision(const std::string& name)
+{
+    std::vector<std::vector<float>> xs = {{0.0f, 0.0f}, {0.0f, 1.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}};
+    std::vector<std::vector<float>> ys = {{0.0f}, {1.0f}, {1.0f}, {0.0f}};
+    auto train = [&xs, &ys](auto nn)
+    {
+        auto before = nn::loss(xs, ys, nn)(0, 0);
+        auto after = nn::loss(xs, ys, nn::train(xs, ys, nn, numeric::constant_learning_rate(1.0f), 2000))(0, 0);
+        return std::make_pair((float) before, (float) after);
+    };
+
+    // the same network, with float weights and with weights of type T
+    rng::set_seed(1);
+    auto reference = train(nn::init_neural_network<float>({2, 3, 3, 1}));
+    rng::set_seed(1);
+    auto losses = train(nn::init_neural_network<T>({2, 3, 3, 1}));
+    std::cout << std::endl;
+    std::cout << name << " network, loss before / after training : " << losses.first << " / " << losses.second
+              << " (float : " << reference.first << " / " << reference.second << ")" << std::endl;
+
+    // xor is learnt, as well as with float weights
+    assert(reference.second < 0.01f);
+    assert(losses.second < 2.0f * reference.second);
+}
+
+/*
+ * a sparse (one-hot) batch trains exactly like the same batch stored densely
+ */
+void test_neural_network_sparse_003()
+{
+    auto nn = nn::init_neural_network({1000, 32, 1000}, nn::Initializer::xavier);
+    std::vector<matrix::SparseMatrix::Triplet> triplets;
+    for(int i=0; i<16; i++)
+    {
+        triplets.push_back({i, (i * 37) % 1000, 1.0f});
+    }
+    matrix::SparseMatrix xs(16, 1000, triplets);
+    auto xs_dense = matrix::dense(xs);
+    auto ys = matrix::random(16, 1000);
+
+    auto nn_sparse = nn;
+    auto nn_dense = nn;
+    nn::Workspace<float> workspace;
+    for(int i=0; i<10; i++)
+    {
+        nn::backpropagation(xs, ys, nn_sparse, 0.1f, workspace);
+        nn::backpropagation(xs_dense, ys, nn_dense, 0.1f, workspace);
+    }
+    auto difference = 0.0f;
+    for(int i=0; i<nn.size(); i++)
+    {
+        for(int j=0; j<nn[i].size(); j++)
+        {
+            difference = std::max(difference, fabsf(nn_sparse[i].data()[j] - nn_dense[i].data()[j]));
+        }
+    }
+    auto as = std::get<0>(nn::feedforward(xs, nn_sparse));
+    std::cout << std::endl;
+    std::cout << "sparse / dense training, max weight difference : " << difference << std::endl;
+    assert(difference < 1e-5f);
+    assert(matrix::rows(as[0]) == 0 && matrix::rows(as[2]) == 16);
+}
+
+/*
+ * a network with a compile-time topology computes the same outputs as the dynamic network it was copied from
+ */
+void test_neural_network_fixed_004()
+{
+    auto nn = nn::init_neural_network({2, 3, 3, 1});
+    std::vector<std::vector<float>> xs = {{0.0f, 0.0f}, {0.0f, 1.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}};
+    std::vector<std::vector<float>> ys = {{0.0f}, {1.0f}, {1.0f}, {0.0f}};
+    nn = nn::train(xs, ys, nn, numeric::constant_learning_rate(0.1f), 1000);
+    auto expected = std::get<0>(nn::feedforward(xs, nn)).back();
+
+    nn::FixedNetwork<2, 3, 3, 1> fixed(nn);
+    matrix::FixedMatrix<4, 2> xs_fixed = {{0.0f, 0.0f}, {0.0f, 1.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}};
+    auto out = fixed.feedforward(xs_fixed);
+    auto difference = 0.0f;
+    for(int i=0; i<4; i++)
+    {
+        difference = std::max(difference, fabsf(out(i, 0) - expected(i, 0)));
+    }
+
+    // single row latency
+    matrix::FixedMatrix<1, 2> x = {{1.0f, 0.0f}};
+    auto sum = 0.0f;
+    auto start = std::chrono::steady_clock::now();
+    for(int i=0; i<100000; i++)
+    {
+        x(0, 1) = i % 2;
+        sum += fixed.feedforward(x)(0, 0);
+    }
+    auto stop = std::chrono::steady_clock::now();
+
+    std::cout << std::endl;
+    std::cout << "fixed network, max difference : " << difference << std::endl;
+    std::cout << "fixed network, time per inference : " << std::chrono::duration<double, std::nano>(stop - start).count() / 100000 << " ns (" << sum << ")" << std::endl;
+    assert(difference < 1e-6f);
+}
+
 int main()
 {
     test_neural_network_002();
+    test_neural_network_sparse_003();
+    test_neural_network_fixed_004();
+    test_neural_network_precision<double>("double");
+    test_neural_network_precision<matrix::bfloat16>("bfloat16");
+    test_neural_network_precision<matrix::float16>("float16");
 }
@@ -0,0 +1,110 @@
+#include "../dual.hpp"
+#include "../gradient_descent.hpp"
+#include "../neural_network.hpp"
+#include "../optimizer.hpp"
+
+#include <assert.h>
+#include <iostream>
+#include <math.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * every optimizer minimizes an ill-conditioned quadratic; the adaptive ones and momentum get there faster than plain SGD
+ */
+void test_optimizer_001()
+{
+    // f(xs) = (x0 - 1)^2 + 50 * (x1 + 2)^2
+    auto f = [](const auto& xs)
+    {
+        return (xs[0] - 1.0f) * (xs[0] - 1.0f) + 50.0f * (xs[1] + 2.0f) * (xs[1] + 2.0f);
+    };
+    numeric::GradientFunction gradient = [&f](const std::vector<float>& xs, float y, std::vector<float>& ds)
+    {
+        autodiff::gradient(f, xs, ds);
+    };
+
+    // number of iterations to get within 1e-3 of the minimum
+    auto iterations = [&f, &gradient](optim::Optimizer<>& optimizer, float learning_rate)
+    {
+        auto xs = std::vector<float> {0.0f, 0.0f};
+        std::vector<float> ds;
+        for(int i=0; i<100000; i++)
+        {
+            if(fabs(xs[0] - 1.0f) < 1e-3f && fabs(xs[1] + 2.0f) < 1e-3f)
+            {
+                return i;
+            }
+            gradient(xs, f(xs), ds);
+            optimizer.update(0, xs, ds, learning_rate);
+        }
+        return 100000;
+    };
+
+    std::vector<std::pair<std::string, std::shared_ptr<optim::Optimizer<>>>> optimizers =
+    {
+        {"sgd", std::make_shared<optim::SGD<>>()},
+        {"momentum", std::make_shared<optim::Momentum<>>(0.9f)},
+        {"nesterov", std::make_shared<optim::Nesterov<>>(0.9f)},
+        {"rmsprop", std::make_shared<optim::RMSProp<>>()},
+        {"adagrad", std::make_shared<optim::AdaGrad<>>()},
+        {"adam", std::make_shared<optim::Adam<>>()}
+    };
+    std::vector<float> learning_rates = {0.009f, 0.009f, 0.009f, 0.01f, 0.5f, 0.05f};
+    std::cout << std::endl;
+    std::vector<int> counts;
+    for(int i=0; i<optimizers.size(); i++)
+    {
+        counts.push_back(iterations(*optimizers[i].second, learning_rates[i]));
+        std::cout << optimizers[i].first << " : " << counts[i] << " iterations" << std::endl;
+        assert(counts[i] < 100000);
+    }
+    assert(counts[1] < counts[0]);
+    assert(counts[2] < counts[0]);
+    assert(counts[5] < counts[0]);
+
+    // gradient descent takes the optimizer
+    optim::Adam<> adam;
+    auto min_xs = numeric::gradient_descent([&f](std::vector<float> xs)
+    {
+        return f(xs);
+    }, gradient, {0.0f, 0.0f}, numeric::constant_learning_rate(0.05f), adam, 2000);
+    assert(fabs(min_xs[0] - 1.0f) < 1e-2f && fabs(min_xs[1] + 2.0f) < 1e-2f);
+}
+
+/*
+ * nn::train uses the learning rate of the schedule for every step, and takes an optimizer
+ */
+void test_optimizer_002()
+{
+    std::vector<std::vector<float>> xs = {{0.0f, 0.0f}, {0.0f, 1.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}};
+    std::vector<std::vector<float>> ys = {{0.0f}, {1.0f}, {1.0f}, {0.0f}};
+    rng::set_seed(16);
+    auto nn = nn::init_neural_network({2, 3, 3, 1}, nn::Initializer::xavier);
+
+    // a zero learning rate leaves the network untouched
+    auto frozen = nn::train(xs, ys, nn, numeric::constant_learning_rate(0.0f), 10);
+    for(int i=0; i<nn.size(); i++)
+    {
+        assert(std::equal(nn[i].data(), nn[i].data() + nn[i].size(), frozen[i].data()));
+    }
+
+    // adam reaches a lower loss than sgd in the same number of epochs
+    auto before = nn::loss(xs, ys, nn)(0, 0);
+    auto sgd_nn = nn::train(xs, ys, nn, numeric::constant_learning_rate(0.1f), 500);
+    optim::Adam<> adam;
+    auto adam_nn = nn::train(xs, ys, nn, numeric::constant_learning_rate(0.02f), adam, 500);
+    auto sgd_loss = nn::loss(xs, ys, sgd_nn)(0, 0);
+    auto adam_loss = nn::loss(xs, ys, adam_nn)(0, 0);
+    std::cout << std::endl;
+    std::cout << "xor loss before training : " << before << ", after 500 epochs of sgd : " << sgd_loss << ", of adam : " << adam_loss << std::endl;
+    assert(adam_loss < sgd_loss);
+    assert(adam_loss < 0.75f * before);
+}
+
+int main()
+{
+    test_optimizer_001();
+    test_optimizer_002();
+}
@@ -0,0 +1,142 @@
+#include "../matrix.hpp"
+#include "../reductions.hpp"
+#include "../thread_pool.hpp"
+
+#include <assert.h>
+#include <chrono>
+#include <iostream>
+#include <math.h>
+#include <thread>
+#include <vector>
+
+/*
+ * global reductions must match straightforward double precision loops, for sizes around the SIMD and block boundaries
+ */
+void test_reductions_001()
+{
+    std::cout << std::endl;
+    for(auto size : {1, 7, 8, 33, 4095, 4097, 100000})
+    {
+        auto m = matrix::random(1, size);
+        m *= 2.0f;
+        m -= matrix::FloatMatrix(1, size, 1.0f);
+        auto sum = 0.0;
+        auto sum_squares = 0.0;
+        auto sum_abs = 0.0;
+        auto max = -INFINITY;
+        auto min = INFINITY;
+        auto argmax = 0;
+        for(int i=0; i<size; i++)
+        {
+            auto x = m.data()[i];
+            sum += x;
+            sum_squares += x * x;
+            sum_abs += fabs(x);
+            min = std::min(min, x);
+            if(x > max)
+            {
+                max = x;
+                argmax = i;
+            }
+        }
+        std::cout << "reductions of " << size << " elements, sum error : " << fabs(matrix::sum(m) - sum)
+                  << ", norm error : " << fabs(matrix::norm(m) - sqrt(sum_squares)) << std::endl;
+        assert(fabs(matrix::sum(m) - sum) < 1e-5 * size);
+        assert(fabs(matrix::mean(m) - sum / size) < 1e-5);
+        assert(fabs(matrix::squared_norm(m) - sum_squares) < 1e-5 * size);
+        assert(fabs(matrix::norm1(m) - sum_abs) < 1e-5 * size);
+        assert(matrix::max(m) == max);
+        assert(matrix::min(m) == min);
+        assert(matrix::norm_inf(m) == std::max(max, -min));
+        assert(matrix::argmax(m) == argmax);
+    }
+}
+
+/*
+ * row-wise and column-wise reductions, of matrices and of (fused) expressions
+ */
+void test_reductions_002()
+{
+    auto a = matrix::random(37, 53);
+    auto b = matrix::random(37, 53);
+    auto row_sums = matrix::sum(a, matrix::Direction::rowwise);
+    auto col_sums = matrix::sum(a, matrix::Direction::colwise);
+    auto col_max = matrix::max(a, matrix::Direction::colwise);
+    auto row_min = matrix::min(a, matrix::Direction::rowwise);
+    auto col_errors = matrix::squared_norm(a - b, matrix::Direction::colwise);
+    auto classes = matrix::argmax(a, matrix::Direction::rowwise);
+    auto col_argmax = matrix::argmax(a, matrix::Direction::colwise);
+    assert(matrix::rows(row_sums) == 37 && matrix::cols(row_sums) == 1);
+    assert(matrix::rows(col_sums) == 1 && matrix::cols(col_sums) == 53);
+    auto err = 0.0f;
+    for(int i=0; i<37; i++)
+    {
+        auto s = 0.0f;
+        for(int j=0; j<53; j++)
+        {
+            s += a(i, j);
+            assert(a(i, j) >= row_min(i, 0));
+            assert(a(i, j) <= a(i, classes[i]));
+        }
+        err = std::max(err, fabsf(s - row_sums(i, 0)));
+    }
+    for(int j=0; j<53; j++)
+    {
+        auto s = 0.0f;
+        auto s2 = 0.0f;
+        for(int i=0; i<37; i++)
+        {
+            s += a(i, j);
+            s2 += (a(i, j) - b(i, j)) * (a(i, j) - b(i, j));
+            assert(a(i, j) <= col_max(0, j));
+        }
+        assert(a(col_argmax[j], j) == col_max(0, j));
+        err = std::max(err, fabsf(s - col_sums(0, j)));
+        err = std::max(err, fabsf(s2 - col_errors(0, j)));
+    }
+    std::cout << std::endl;
+    std::cout << "row-wise / column-wise reductions, max error : " << err << std::endl;
+    assert(err < 1e-4f);
+
+    // half-width and double matrices reduce in their accumulator type
+    auto a_bf16 = matrix::cast<matrix::bfloat16>(a);
+    auto a_double = matrix::cast<double>(a);
+    assert(fabs(matrix::sum(a_double) - matrix::sum(a)) < 1e-3);
+    assert(fabs(matrix::sum(a_bf16) - matrix::sum(a)) < matrix::sum(a) / 128);
+}
+
+/*
+ * results do not depend on the number of threads, and time a large reduction
+ */
+void test_reductions_003()
+{
+    auto m = matrix::random(1024, 1024);
+    parallel::set_number_of_threads(1);
+    auto serial_sum = matrix::sum(m);
+    auto serial_cols = matrix::sum(m, matrix::Direction::colwise);
+    parallel::set_number_of_threads(4);
+    parallel::set_serial_threshold(64);
+    auto parallel_sum = matrix::sum(m);
+    auto parallel_cols = matrix::sum(m, matrix::Direction::colwise);
+    assert(serial_sum == parallel_sum);
+    assert(std::equal(serial_cols.data(), serial_cols.data() + 1024, parallel_cols.data()));
+    parallel::set_number_of_threads(std::max(1u, std::thread::hardware_concurrency()));
+    parallel::set_serial_threshold(1 << 16);
+
+    auto start = std::chrono::steady_clock::now();
+    auto s = 0.0f;
+    for(int i=0; i<10; i++)
+    {
+        s += matrix::squared_norm(m);
+    }
+    auto stop = std::chrono::steady_clock::now();
+    std::cout << std::endl;
+    std::cout << "squared norm of 1024x1024 : " << std::chrono::duration<double, std::milli>(stop - start).count() / 10 << " ms (" << s << ")" << std::endl;
+}
+
+int main()
+{
+    test_reductions_001();
+    test_reductions_002();
+    test_reductions_003();
+}
@@ -0,0 +1,111 @@
+#include "../matrix.hpp"
+#include "../neural_network.hpp"
+#include "../reductions.hpp"
+#include "../rng.hpp"
+
+#include <assert.h>
+#include <iostream>
+#include <math.h>
+#include <thread>
+#include <vector>
+
+bool equal(const matrix::FloatMatrix& a, const matrix::FloatMatrix& b)
+{
+    return a.rows() == b.rows() && a.cols() == b.cols() && std::equal(a.data(), a.data() + a.size(), b.data());
+}
+
+/*
+ * the same seed reproduces the same network, and layers of the same shape get different weights
+ */
+void test_rng_001()
+{
+    rng::set_seed(42);
+    auto nn0 = nn::init_neural_network({4, 4, 4});
+    rng::set_seed(42);
+    auto nn1 = nn::init_neural_network({4, 4, 4});
+    rng::set_seed(43);
+    auto nn2 = nn::init_neural_network({4, 4, 4});
+
+    std::cout << std::endl;
+    std::cout << "same seed, same weights : " << (equal(nn0[0], nn1[0]) && equal(nn0[1], nn1[1])) << std::endl;
+    std::cout << "different layers, different weights : " << !equal(nn0[0], nn0[1]) << std::endl;
+    std::cout << "different seed, different weights : " << !equal(nn0[0], nn2[0]) << std::endl;
+    assert(equal(nn0[0], nn1[0]) && equal(nn0[1], nn1[1]));
+    assert(!equal(nn0[0], nn0[1]));
+    assert(!equal(nn0[0], nn2[0]));
+}
+
+/*
+ * every thread draws from its own stream
+ */
+void test_rng_002()
+{
+    rng::set_seed(7);
+    std::vector<uint64_t> firsts(4);
+    std::vector<std::thread> threads;
+    for(int i=0; i<4; i++)
+    {
+        threads.emplace_back([i, &firsts]()
+        {
+            firsts[i] = rng::thread_generator()();
+        });
+    }
+    for(auto& t : threads)
+    {
+        t.join();
+    }
+    auto distinct = true;
+    for(int i=0; i<4; i++)
+    {
+        for(int j=i+1; j<4; j++)
+        {
+            distinct &= firsts[i] != firsts[j];
+        }
+    }
+    std::cout << std::endl;
+    std::cout << "per-thread streams are distinct : " << distinct << std::endl;
+    assert(distinct);
+}
+
+/*
+ * moments of the uniform and normal distributions, range of the Xavier initializer
+ */
+void test_rng_003()
+{
+    rng::Generator g(123);
+    auto N = 1 << 20;
+    auto u_mean = 0.0;
+    auto n_mean = 0.0;
+    auto n_var = 0.0;
+    for(int i=0; i<N; i++)
+    {
+        auto u = g.uniform();
+        assert(u >= 0.0f && u < 1.0f);
+        u_mean += u;
+        auto n = g.normal();
+        n_mean += n;
+        n_var += n * n;
+    }
+    u_mean /= N;
+    n_mean /= N;
+    n_var = n_var / N - n_mean * n_mean;
+
+    auto w = matrix::xavier(100, 50, g);
+    auto l = sqrt(6.0f / 150.0f);
+
+    std::cout << std::endl;
+    std::cout << "uniform mean : " << u_mean << std::endl;
+    std::cout << "normal mean : " << n_mean << ", variance : " << n_var << std::endl;
+    std::cout << "xavier range : [" << matrix::min(w) << " .. " << matrix::max(w) << "], limit : " << l << std::endl;
+    assert(fabs(u_mean - 0.5) < 0.01);
+    assert(fabs(n_mean) < 0.01);
+    assert(fabs(n_var - 1.0) < 0.01);
+    assert(matrix::min(w) >= -l && matrix::max(w) < l);
+}
+
+int main()
+{
+    test_rng_001();
+    test_rng_002();
+    test_rng_003();
+}
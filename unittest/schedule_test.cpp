@@ -0,0 +1,117 @@
+#include "../gradient_descent.hpp"
+#include "../neural_network.hpp"
+#include "../schedule.hpp"
+
+#include <assert.h>
+#include <iostream>
+#include <math.h>
+#include <vector>
+
+/*
+ * the shapes of the schedules
+ */
+void test_schedule_001()
+{
+    // cosine annealing: 10 iterations, then 20, then 40
+    optim::CosineRestarts cosine(1.0f, 10, 2, 0.1f);
+    assert(cosine(0) == 1.0f);
+    assert(fabs(cosine(5) - 0.55f) < 1e-6f);
+    assert(cosine(9) < 0.15f);
+    assert(cosine(10) == 1.0f);
+    assert(fabs(cosine(20) - 0.55f) < 1e-6f);
+    assert(cosine(30) == 1.0f);
+
+    // a function schedule keeps its own copy of the function, so it can be built from a temporary
+    optim::FunctionSchedule step_decay(numeric::step_decay_learning_rate(1.0f, 0.5f, 10));
+    assert(step_decay(0) == 1.0f && step_decay(9) == 0.5f);
+
+    // warmup ramps up linearly to the other schedule
+    optim::CosineRestarts inner(1.0f, 1000);
+    optim::Warmup warmup(inner, 4);
+    assert(warmup(0) == 0.25f * inner(0));
+    assert(warmup(2) == 0.75f * inner(2));
+    assert(warmup(4) == inner(4));
+
+    // one-cycle rises to the maximum at 30%, then anneals far below the start
+    optim::OneCycle one_cycle(1.0f, 100);
+    assert(fabs(one_cycle(0) - 1.0f / 25.0f) < 1e-6f);
+    assert(one_cycle(15) > one_cycle(0) && one_cycle(15) < 1.0f);
+    assert(one_cycle(30) == 1.0f);
+    assert(one_cycle(60) < 1.0f && one_cycle(60) > one_cycle(90));
+    assert(fabs(one_cycle(100) - 1.0f / 25.0f / 1e4f) < 1e-9f);
+    assert(one_cycle(200) == one_cycle(100));
+
+    // reduce on plateau: halves after patience iterations without improvement, not while improving
+    optim::ReduceOnPlateau plateau(1.0f, 0.5f, 3);
+    for(int i=0; i<10; i++)
+    {
+        plateau.observe(10.0f - i);
+    }
+    assert(plateau(10) == 1.0f);
+    for(int i=0; i<4; i++)
+    {
+        assert(plateau(10 + i) == 1.0f);
+        plateau.observe(1.0f);
+    }
+    assert(plateau(14) == 0.5f);
+    plateau.reset();
+    assert(plateau(0) == 1.0f);
+}
+
+/*
+ * gradient descent on |x| oscillates around the minimum with a constant learning rate,
+ * reducing it on plateaus gets much closer; nn::train reports the loss of every epoch
+ */
+void test_schedule_002()
+{
+    auto f = [](const std::vector<float>& xs)
+    {
+        return fabsf(xs[0] - 0.3f);
+    };
+    auto gradient = [](const std::vector<float>& xs, float y, std::vector<float>& ds)
+    {
+        ds[0] = xs[0] > 0.3f ? 1.0f : -1.0f;
+    };
+    optim::SGD<> sgd;
+    auto constant_xs = numeric::gradient_descent(f, gradient, {1.05f}, numeric::constant_learning_rate(0.1f), sgd, 500);
+    optim::ReduceOnPlateau plateau(0.1f, 0.5f, 5);
+    auto plateau_xs = numeric::gradient_descent(f, gradient, {1.05f}, plateau, sgd, 500);
+    std::cout << std::endl;
+    std::cout << "min |x - 0.3|, constant learning rate : " << f(constant_xs) << ", reduce on plateau : " << f(plateau_xs) << std::endl;
+    assert(f(constant_xs) > 1e-3f);
+    assert(f(plateau_xs) < 1e-5f);
+
+    // a schedule that records the losses it observes
+    class Recorder : public optim::Schedule
+    {
+        public:
+
+            float learning_rate(int iteration_nr) override
+            {
+                return 0.5f;
+            }
+
+            void observe(float loss) override
+            {
+                losses.push_back(loss);
+            }
+
+            std::vector<float> losses;
+    };
+    std::vector<std::vector<float>> xs = {{0.0f, 0.0f}, {0.0f, 1.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}};
+    std::vector<std::vector<float>> ys = {{0.0f}, {0.0f}, {0.0f}, {1.0f}};
+    rng::set_seed(20);
+    auto nn = nn::init_neural_network({2, 3, 1}, nn::Initializer::xavier);
+    Recorder recorder;
+    optim::SGD<> nn_sgd;
+    auto trained = nn::train(xs, ys, nn, recorder, nn_sgd, 200);
+    assert(recorder.losses.size() == 200);
+    assert(recorder.losses.back() < recorder.losses.front());
+    std::cout << "and, epoch loss after 1 epoch : " << recorder.losses.front() << ", after 200 epochs : " << recorder.losses.back() << std::endl;
+}
+
+int main()
+{
+    test_schedule_001();
+    test_schedule_002();
+}
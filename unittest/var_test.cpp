@@ -0,0 +1,150 @@
+#include "../var.hpp"
+#include "../linear_regression.hpp"
+#include "../rng.hpp"
+
+#include <assert.h>
+#include <chrono>
+#include <iostream>
+#include <math.h>
+#include <vector>
+
+/*
+ * a reverse-mode gradient with hundreds of parameters matches the analytic gradient, and reuses the tape memory
+ */
+void test_var_001()
+{
+    // f(xs) = sum_i (i + 1) * xs[i]^2 + xs[0] * xs[n - 1] + exp(xs[1]) / xs[2]
+    auto f = [](const auto& xs)
+    {
+        auto y = xs[0] * xs[xs.size() - 1] + exp(xs[1]) / xs[2];
+        for(int i=0; i<xs.size(); i++)
+        {
+            y += (i + 1.0f) * xs[i] * xs[i];
+        }
+        return y;
+    };
+    int n = 500;
+    std::vector<float> xs;
+    for(int i=0; i<n; i++)
+    {
+        xs.push_back(0.01f * i - 2.0f);
+    }
+    std::vector<float> ds;
+    auto y = autodiff::gradient(autodiff::reverse_mode, f, xs, ds);
+    assert(fabs(y - f(xs)) <= 1e-5f * fabs(y));
+    for(int i=0; i<n; i++)
+    {
+        auto exact = 2.0f * (i + 1.0f) * xs[i];
+        exact += i == 0 ? xs[n - 1] : 0.0f;
+        exact += i == n - 1 ? xs[0] : 0.0f;
+        exact += i == 1 ? expf(xs[1]) / xs[2] : 0.0f;
+        exact += i == 2 ? -expf(xs[1]) / (xs[2] * xs[2]) : 0.0f;
+        assert(fabs(ds[i] - exact) <= 1e-4f * (1.0f + fabs(exact)));
+    }
+
+    // forward mode agrees, at a cost of n / 8 passes instead of one
+    std::vector<float> forward_ds;
+    auto start = std::chrono::steady_clock::now();
+    autodiff::gradient(autodiff::forward_mode, f, xs, forward_ds);
+    auto forward_time = std::chrono::steady_clock::now() - start;
+    start = std::chrono::steady_clock::now();
+    autodiff::gradient(autodiff::reverse_mode, f, xs, ds);
+    auto reverse_time = std::chrono::steady_clock::now() - start;
+    for(int i=0; i<n; i++)
+    {
+        assert(fabs(ds[i] - forward_ds[i]) <= 1e-4f * (1.0f + fabs(ds[i])));
+    }
+    std::cout << std::endl;
+    std::cout << "gradient of " << n << " parameters, forward mode : " << std::chrono::duration<double, std::milli>(forward_time).count()
+              << " ms, reverse mode : " << std::chrono::duration<double, std::milli>(reverse_time).count() << " ms" << std::endl;
+
+    // the tape keeps its memory
+    auto capacity = autodiff::thread_tape().capacity();
+    autodiff::gradient(autodiff::reverse_mode, f, xs, ds);
+    assert(autodiff::thread_tape().capacity() == capacity);
+    assert(autodiff::thread_tape().size() == 0);
+
+    // constants are not recorded, branches follow the value
+    auto g = [](const auto& xs)
+    {
+        auto y = xs[0] * 2.0f;
+        if(y > 1.0f)
+        {
+            y = 1.0f;
+        }
+        return y + 3.0f;
+    };
+    autodiff::gradient(autodiff::reverse_mode, g, {0.25f}, ds);
+    assert(ds[0] == 2.0f);
+    autodiff::gradient(autodiff::reverse_mode, g, {2.0f}, ds);
+    assert(ds[0] == 0.0f);
+}
+
+/*
+ * fit a linear model through the generic linear regression interface
+ */
+void test_var_002()
+{
+    rng::set_seed(14);
+    auto& generator = rng::thread_generator();
+    int features = 8;
+    std::vector<float> coeffs;
+    for(int j=0; j<=features; j++)
+    {
+        coeffs.push_back(generator.uniform(-1.0f, 1.0f));
+    }
+    std::vector<std::vector<float>> xs;
+    std::vector<float> ys;
+    for(int i=0; i<256; i++)
+    {
+        std::vector<float> x;
+        auto y = coeffs[features];
+        for(int j=0; j<features; j++)
+        {
+            x.push_back(generator.uniform(-1.0f, 1.0f));
+            y += x[j] * coeffs[j];
+        }
+        xs.push_back(x);
+        ys.push_back(y);
+    }
+
+    // prediction and (mean squared error) loss, generic in the type of the parameters
+    auto pred_function = [](const auto& params, matrix::Span<const float> xs)
+    {
+        auto y = params[params.size() - 1];
+        for(int i=0; i<xs.size(); i++)
+        {
+            y += xs[i] * params[i];
+        }
+        return y;
+    };
+    auto loss_function = [](matrix::Span<const float> ys, const auto& pred_ys)
+    {
+        auto loss = (pred_ys[0] - ys[0]) * (pred_ys[0] - ys[0]);
+        for(int i=1; i<ys.size(); i++)
+        {
+            loss += (pred_ys[i] - ys[i]) * (pred_ys[i] - ys[i]);
+        }
+        return loss / ys.size();
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    auto params = numeric::linear_regression(autodiff::reverse_mode, xs, ys, pred_function, std::vector<float>(features + 1, 0.0f),
+                  loss_function, numeric::constant_learning_rate(0.5f), 256);
+    auto stop = std::chrono::steady_clock::now();
+    auto err = 0.0f;
+    for(int j=0; j<=features; j++)
+    {
+        err = std::max(err, fabsf(params[j] - coeffs[j]));
+    }
+    std::cout << std::endl;
+    std::cout << "linear regression with " << features << " features (reverse mode) : " << std::chrono::duration<double, std::milli>(stop - start).count()
+              << " ms, max coefficient error : " << err << std::endl;
+    assert(err < 1e-2f);
+}
+
+int main()
+{
+    test_var_001();
+    test_var_002();
+}
@@ -0,0 +1,347 @@
+#pragma once
+
+#include <assert.h>
+#include <math.h>
+#include <vector>
+
+#include "dual.hpp"
+
+namespace autodiff
+{
+
+    /*!
+     * Tape for reverse-mode automatic differentiation: every operation on Vars appends a node
+     * holding (up to two) operand indices and the local partial derivatives with respect to them.
+     * A backward sweep over the nodes in reverse order accumulates the adjoints, yielding the full gradient
+     * in one pass whatever the number of inputs.
+     * The node storage acts as an arena: clear() keeps its capacity, so recording the same computation again does not allocate.
+     */
+    class Tape
+    {
+        public:
+
+            struct Node
+            {
+                int operands[2];
+                float partials[2];
+            };
+
+            /*! append a node and return its index (operands < 0 are constants, and are ignored)
+             */
+            int push(int operand_0 = -1, float partial_0 = 0.0f, int operand_1 = -1, float partial_1 = 0.0f)
+            {
+                nodes.push_back({{operand_0, operand_1}, {partial_0, partial_1}});
+                return nodes.size() - 1;
+            }
+
+            /*! forget all nodes, keeping the memory for the next recording
+             */
+            void clear()
+            {
+                nodes.clear();
+            }
+
+            int size() const
+            {
+                return nodes.size();
+            }
+
+            int capacity() const
+            {
+                return nodes.capacity();
+            }
+
+            /*! propagate the adjoint 1 of the given node back to all nodes it depends on, adjoints are returned per node
+             */
+            const std::vector<float>& backward(int output)
+            {
+                assert(output >= 0 && output < nodes.size());
+                adjoints.assign(output + 1, 0.0f);
+                adjoints[output] = 1.0f;
+                for(int i=output; i>=0; i--)
+                {
+                    auto a = adjoints[i];
+                    if(a == 0.0f)
+                    {
+                        continue;
+                    }
+                    auto& node = nodes[i];
+                    for(int k=0; k<2; k++)
+                    {
+                        if(node.operands[k] >= 0)
+                        {
+                            adjoints[node.operands[k]] += node.partials[k] * a;
+                        }
+                    }
+                }
+                return adjoints;
+            }
+
+        private:
+
+            std::vector<Node> nodes;
+            std::vector<float> adjoints;
+    };
+
+    /*!
+     * Return the tape of the calling thread, on which all Var operations of that thread are recorded.
+     */
+    Tape& thread_tape()
+    {
+        thread_local Tape tape;
+        return tape;
+    }
+
+    /*!
+     * A variable for reverse-mode automatic differentiation: a value and the index of the tape node that computed it
+     * (or -1 for constants, which are not recorded).
+     */
+    struct Var
+    {
+        float value;
+        int index;
+
+        Var() = default;
+
+        /*! a constant
+         */
+        Var(float value)
+            : value(value), index(-1)
+        {
+        }
+
+        Var(float value, int index)
+            : value(value), index(index)
+        {
+        }
+
+        Var& operator+=(const Var& b);
+        Var& operator-=(const Var& b);
+        Var& operator*=(const Var& b);
+        Var& operator/=(const Var& b);
+    };
+
+    /*
+     * record unary and binary operations, given their value and local partial derivatives
+     */
+    Var record(const Var& a, float value, float partial)
+    {
+        if(a.index < 0)
+        {
+            return Var(value);
+        }
+        return Var(value, thread_tape().push(a.index, partial));
+    }
+
+    Var record(const Var& a, const Var& b, float value, float partial_a, float partial_b)
+    {
+        if(a.index < 0 && b.index < 0)
+        {
+            return Var(value);
+        }
+        return Var(value, thread_tape().push(a.index, partial_a, b.index, partial_b));
+    }
+
+    Var operator-(const Var& a)
+    {
+        return record(a, -a.value, -1.0f);
+    }
+
+    Var operator+(const Var& a, const Var& b)
+    {
+        return record(a, b, a.value + b.value, 1.0f, 1.0f);
+    }
+
+    Var operator-(const Var& a, const Var& b)
+    {
+        return record(a, b, a.value - b.value, 1.0f, -1.0f);
+    }
+
+    Var operator*(const Var& a, const Var& b)
+    {
+        return record(a, b, a.value * b.value, b.value, a.value);
+    }
+
+    Var operator/(const Var& a, const Var& b)
+    {
+        auto inv = 1.0f / b.value;
+        auto value = a.value * inv;
+        return record(a, b, value, inv, -value * inv);
+    }
+
+    Var& Var::operator+=(const Var& b)
+    {
+        return *this = *this + b;
+    }
+
+    Var& Var::operator-=(const Var& b)
+    {
+        return *this = *this - b;
+    }
+
+    Var& Var::operator*=(const Var& b)
+    {
+        return *this = *this * b;
+    }
+
+    Var& Var::operator/=(const Var& b)
+    {
+        return *this = *this / b;
+    }
+
+    /*
+     * mixed arithmetic with plain numbers (constants) only records a single operand
+     */
+    template<typename S, typename = enable_if_scalar<S>>
+    Var operator+(const Var& a, S s)
+    {
+        return record(a, a.value + s, 1.0f);
+    }
+
+    template<typename S, typename = enable_if_scalar<S>>
+    Var operator+(S s, const Var& a)
+    {
+        return record(a, s + a.value, 1.0f);
+    }
+
+    template<typename S, typename = enable_if_scalar<S>>
+    Var operator-(const Var& a, S s)
+    {
+        return record(a, a.value - s, 1.0f);
+    }
+
+    template<typename S, typename = enable_if_scalar<S>>
+    Var operator-(S s, const Var& a)
+    {
+        return record(a, s - a.value, -1.0f);
+    }
+
+    template<typename S, typename = enable_if_scalar<S>>
+    Var operator*(const Var& a, S s)
+    {
+        return record(a, a.value * s, s);
+    }
+
+    template<typename S, typename = enable_if_scalar<S>>
+    Var operator*(S s, const Var& a)
+    {
+        return record(a, s * a.value, s);
+    }
+
+    template<typename S, typename = enable_if_scalar<S>>
+    Var operator/(const Var& a, S s)
+    {
+        auto inv = 1.0f / s;
+        return record(a, a.value * inv, inv);
+    }
+
+    template<typename S, typename = enable_if_scalar<S>>
+    Var operator/(S s, const Var& a)
+    {
+        auto value = s / a.value;
+        return record(a, value, -value / a.value);
+    }
+
+    /*
+     * comparisons look at values only (see the comparison operators in dual.hpp)
+     */
+    float value_of(const Var& a)
+    {
+        return a.value;
+    }
+
+    /*
+     * elementary functions, found through argument dependent lookup
+     */
+    Var exp(const Var& a)
+    {
+        auto e = expf(a.value);
+        return record(a, e, e);
+    }
+
+    Var log(const Var& a)
+    {
+        return record(a, logf(a.value), 1.0f / a.value);
+    }
+
+    Var sqrt(const Var& a)
+    {
+        auto s = sqrtf(a.value);
+        return record(a, s, 0.5f / s);
+    }
+
+    template<typename S, typename = enable_if_scalar<S>>
+    Var pow(const Var& a, S p)
+    {
+        return record(a, ::pow(a.value, p), p * ::pow(a.value, p - 1));
+    }
+
+    Var sin(const Var& a)
+    {
+        return record(a, sinf(a.value), cosf(a.value));
+    }
+
+    Var cos(const Var& a)
+    {
+        return record(a, cosf(a.value), -sinf(a.value));
+    }
+
+    Var tanh(const Var& a)
+    {
+        auto t = tanhf(a.value);
+        return record(a, t, 1.0f - t * t);
+    }
+
+    Var fabs(const Var& a)
+    {
+        return record(a, fabsf(a.value), a.value < 0 ? -1.0f : 1.0f);
+    }
+
+    Var abs(const Var& a)
+    {
+        return fabs(a);
+    }
+
+    /*!
+     * Tag to select reverse-mode automatic differentiation (e.g. numeric::linear_regression(autodiff::reverse_mode, ...)).
+     */
+    struct ReverseMode
+    {
+    };
+
+    const ReverseMode reverse_mode{};
+
+    /*!
+     * Evaluate f at xs and compute its gradient into ds, with reverse-mode automatic differentiation:
+     * f is recorded once on the tape of the calling thread and the gradient follows from a single backward pass,
+     * so the cost does not grow with the number of parameters (memory does: one node per operation).
+     * f must be callable with a std::vector of any scalar type S (float, or Var) and return an S.
+     * f must not itself compute a reverse-mode gradient, as the tape is reset for every gradient.
+     * Returns f(xs).
+     */
+    template<typename F>
+    float gradient(ReverseMode, const F& f, const std::vector<float>& xs, std::vector<float>& ds)
+    {
+        auto& tape = thread_tape();
+        tape.clear();
+        std::vector<Var> vars;
+        vars.reserve(xs.size());
+        for(auto x : xs)
+        {
+            vars.push_back(Var(x, tape.push()));
+        }
+        Var y = f(vars);
+        ds.assign(xs.size(), 0.0f);
+        if(y.index >= 0)
+        {
+            auto& adjoints = tape.backward(y.index);
+            for(int i=0; i<xs.size() && i<adjoints.size(); i++)
+            {
+                ds[i] = adjoints[i];
+            }
+        }
+        tape.clear();
+        return y.value;
+    }
+
+}
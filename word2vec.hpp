@@ -1,13 +1,12 @@
 #pragma once
 
 #include "matrix.hpp"
+#include "rng.hpp"
 
 #include <algorithm>
 #include <functional>
 #include <iostream>
 #include <map>
-#include <stdlib.h>
-#include <time.h>
 #include <tuple>
 #include <vector>
 
@@ -62,10 +61,10 @@ namespace word2vec
             }
             k--;
         }
-        srand(time(NULL));
-        auto pick_random_word = [&word_lookup_table]()
+        auto& generator = rng::thread_generator();
+        auto pick_random_word = [&word_lookup_table, &generator]()
         {
-            return word_lookup_table[rand() % word_lookup_table.size()];
+            return word_lookup_table[generator.uniform_int(word_lookup_table.size())];
         };
 
         // window view on sequence